@@ -0,0 +1,170 @@
+#include "benchmark.h"
+#include "jsonwriter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+    struct Summary {
+        double total = 0.0;     // microseconds over all samples
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+        double itemsPerSecond = 0.0;
+    };
+
+    Summary Summarize(const Benchmark::Result& result)
+    {
+        Summary summary;
+        if (result.samples.empty()) return summary;
+        std::vector<double> sorted = result.samples;
+        std::sort(sorted.begin(), sorted.end());
+        summary.total = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+        summary.mean = summary.total / sorted.size();
+        summary.p50 = Benchmark::Percentile(sorted, 50.0);
+        summary.p90 = Benchmark::Percentile(sorted, 90.0);
+        summary.p99 = Benchmark::Percentile(sorted, 99.0);
+        summary.max = sorted.back();
+        if (summary.total > 0.0) {
+            summary.itemsPerSecond = result.itemsPerCall * sorted.size()
+                / (summary.total / 1000000.0);
+        }
+        return summary;
+    }
+}
+
+Benchmark::Result& Benchmark::AddResult(const std::string& operation, int mapSize,
+    int layerCount)
+{
+    Result result;
+    result.operation = operation;
+    result.mapSize = mapSize;
+    result.layerCount = layerCount;
+    results.push_back(std::move(result));
+    return results.back();
+}
+
+void Benchmark::Skip(const std::string& operation, int mapSize, int layerCount)
+{
+    Result& result = AddResult(operation, mapSize, layerCount);
+    result.isSkipped = true;
+    result.peakRssBytes = GetPeakRss();
+    PrintResult(result);
+}
+
+void Benchmark::PrintResult(const Result& result) const
+{
+    char line[256];
+    if (result.isSkipped) {
+        std::snprintf(line, sizeof(line), "%-20s %5dx%-5d %2d layers  skipped (size limit)",
+            result.operation.c_str(), result.mapSize, result.mapSize, result.layerCount);
+        std::cout << line << "\n";
+        return;
+    }
+    Summary summary = Summarize(result);
+    std::snprintf(line, sizeof(line),
+        "%-20s %5dx%-5d %2d layers  p50 %10.1f us  p90 %10.1f us  p99 %10.1f us  "
+        "%12.0f %s/s  rss %6.0f MB",
+        result.operation.c_str(), result.mapSize, result.mapSize, result.layerCount,
+        summary.p50, summary.p90, summary.p99, summary.itemsPerSecond,
+        result.itemName.c_str(), result.peakRssBytes / (1024.0 * 1024.0));
+    std::cout << line << "\n";
+}
+
+bool Benchmark::WriteJson(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file for writing: " << filename << "\n";
+        return false;
+    }
+
+    // one object per case, times in microseconds, throughput in items per second
+    JsonWriter writer(file, 2);
+    writer.BeginObject();
+    writer.Key("results");
+    writer.BeginArray();
+    for (const Result& result : results) {
+        writer.BeginObject();
+        writer.Key("operation");
+        writer.String(result.operation);
+        writer.Key("mapSize");
+        writer.Int(result.mapSize);
+        writer.Key("layers");
+        writer.Int(result.layerCount);
+        writer.Key("skipped");
+        writer.Bool(result.isSkipped);
+        writer.Key("peakRssBytes");
+        writer.UInt(result.peakRssBytes);
+        if (!result.isSkipped) {
+            Summary summary = Summarize(result);
+            writer.Key("samples");
+            writer.Int(static_cast<std::int64_t>(result.samples.size()));
+            writer.Key("itemsPerCall");
+            writer.Float(result.itemsPerCall);
+            writer.Key("itemName");
+            writer.String(result.itemName);
+            writer.Key("itemsPerSecond");
+            writer.Float(summary.itemsPerSecond);
+            writer.Key("meanUs");
+            writer.Float(summary.mean);
+            writer.Key("p50Us");
+            writer.Float(summary.p50);
+            writer.Key("p90Us");
+            writer.Float(summary.p90);
+            writer.Key("p99Us");
+            writer.Float(summary.p99);
+            writer.Key("maxUs");
+            writer.Float(summary.max);
+        }
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+    file << "\n";
+
+    file.close();
+    if (file.fail()) {
+        std::cerr << "Failed to write results: " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+std::uint64_t Benchmark::GetPeakRss()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return static_cast<std::uint64_t>(counters.PeakWorkingSetSize);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<std::uint64_t>(usage.ru_maxrss);         // bytes on macOS
+#else
+    return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;  // kilobytes on linux
+#endif
+#endif
+}
+
+double Benchmark::Percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
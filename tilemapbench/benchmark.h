@@ -0,0 +1,66 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*  collects timed samples for the benchmark cases and reports them: a case is one
+    operation on one map configuration, every sample is a single timed call. results
+    are printed as a table and written as json so runs of different builds can be
+    compared with a script
+*/
+class Benchmark {
+public:
+    struct Result {
+        std::string operation;
+        int mapSize = 0;            // width and height of every layer
+        int layerCount = 0;
+        bool isSkipped = false;     // over the size limit for this operation
+        std::vector<double> samples;    // microseconds per call
+        double itemsPerCall = 1.0;  // cells, tiles or bytes one call processes
+        std::string itemName = "ops";
+        std::uint64_t peakRssBytes = 0; // process peak after the case
+    };
+
+    // times fn samples times, fn is called once per sample
+    template <typename Fn>
+    Result& Run(const std::string& operation, int mapSize, int layerCount, int samples,
+        Fn&& fn);
+    // records a case that didn't run so the json still lists it
+    void Skip(const std::string& operation, int mapSize, int layerCount);
+    // empty case for samples the caller times itself (e.g. replayed events)
+    Result& AddResult(const std::string& operation, int mapSize, int layerCount);
+
+    void PrintResult(const Result& result) const;
+    // writes every result with its percentiles, returns false on failure
+    bool WriteJson(const std::string& filename) const;
+
+    // peak resident set size of the process so far, 0 where it can't be queried
+    static std::uint64_t GetPeakRss();
+    // nearest-rank percentile of sorted samples, p in [0, 100]
+    static double Percentile(const std::vector<double>& sorted, double p);
+
+private:
+    std::vector<Result> results;
+};
+
+template <typename Fn>
+Benchmark::Result& Benchmark::Run(const std::string& operation, int mapSize,
+    int layerCount, int samples, Fn&& fn)
+{
+    Result& result = AddResult(operation, mapSize, layerCount);
+    result.samples.reserve(samples);
+    for (int i = 0; i < samples; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        result.samples.push_back(
+            std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    result.peakRssBytes = GetPeakRss();
+    return result;
+}
+
+#endif // !BENCHMARK_H
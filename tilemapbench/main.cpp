@@ -0,0 +1,502 @@
+#include "benchmark.h"
+#include "tilemesh.h"
+#include "mapmodel.h"
+#include "mapgenerator.h"
+#include "editlog.h"
+#include "editplayer.h"
+#include "collisionmesh.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*  headless benchmarks of the map core: every operation runs on synthetic maps of each
+    size and layer count and is reported with latency percentiles, throughput and the
+    peak resident set size. "generate" writes a synthetic map file instead, "replay"
+    plays back an edit session recorded in the editor (f5). run with --help for the
+    options
+*/
+
+namespace {
+    struct Options {
+        std::vector<int> sizes{ 50, 200, 1024, 4096 };
+        std::vector<int> layerCounts{ 1, 4, 16 };
+        double density = 0.6;               // share of cells that hold a tile
+        double collisionDensity = 0.1;      // share of cells with collision
+        int editSamples = 10000;            // stamps / erases per case
+        int viewSamples = 200;              // render list builds / zoom steps per case
+        // the json format is verbose, files above these cell counts are skipped
+        long long maxJsonCells = 1LL << 22;
+        long long maxBinaryCells = 1LL << 28;
+        std::string output = "bench_results.json";
+        std::string directory;              // scratch files, defaults to the temp dir
+    };
+
+    // the atlas layout of the maps, matches the editor's 16px tileset
+    const int atlasColumns = 16;
+    const int tileSize = 16;
+    const int tileCount = 256;
+    // the layer view the tile meshes are built for, in window pixels
+    const int viewWidth = 1920;
+    const int viewHeight = 1080;
+
+    void PrintUsage()
+    {
+        std::cout << "usage: tilemapbench [options]\n"
+            "  --sizes 50,200,1024,4096   map widths/heights to run\n"
+            "  --layers 1,4,16            layer counts to run\n"
+            "  --density 0.6              share of cells holding a tile\n"
+            "  --edit-samples 10000       stamps and erases per case\n"
+            "  --view-samples 200         render list builds and zoom steps per case\n"
+            "  --max-json-cells N         skip json save/load above N cells\n"
+            "  --max-binary-cells N       skip binary save/load above N cells\n"
+            "  --out bench_results.json   machine-readable results\n"
+            "  --dir PATH                 directory for the scratch map files\n"
+            "\n"
+            "usage: tilemapbench generate FILE [options]\n"
+            "  writes a synthetic map, .tmb is the binary format and anything else json\n"
+            "  --size 256 / --width 256 --height 256\n"
+            "  --layers 1                 number of layers\n"
+            "  --density 0.6              share of cells holding a tile\n"
+            "  --collision 0.1            share of cells with collision\n"
+            "  --tiles 256                atlas indices used\n"
+            "  --distribution uniform     uniform, zipf or clustered\n"
+            "  --seed 12345\n"
+            "\n"
+            "usage: tilemapbench replay LOG [options]\n"
+            "  plays back an edit session recorded in the editor (f5) at full speed\n"
+            "  --map session_base.tmb     map the session started from\n"
+            "  --render                   update the tile meshes after every event\n"
+            "  --out replay_results.json  machine-readable results\n";
+    }
+
+    bool ParseList(const std::string& text, std::vector<int>& values)
+    {
+        values.clear();
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            int value = std::atoi(item.c_str());
+            if (value <= 0) return false;
+            values.push_back(value);
+        }
+        return !values.empty();
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") return false;
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            std::string value = argv[++i];
+            bool isValid = true;
+            if (arg == "--sizes") isValid = ParseList(value, options.sizes);
+            else if (arg == "--layers") isValid = ParseList(value, options.layerCounts);
+            else if (arg == "--density") options.density = std::atof(value.c_str());
+            else if (arg == "--edit-samples") options.editSamples = std::atoi(value.c_str());
+            else if (arg == "--view-samples") options.viewSamples = std::atoi(value.c_str());
+            else if (arg == "--max-json-cells") options.maxJsonCells = std::atoll(value.c_str());
+            else if (arg == "--max-binary-cells") {
+                options.maxBinaryCells = std::atoll(value.c_str());
+            }
+            else if (arg == "--out") options.output = value;
+            else if (arg == "--dir") options.directory = value;
+            else {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return false;
+            }
+            if (!isValid) {
+                std::cerr << "Invalid list for " << arg << ": " << value << "\n";
+                return false;
+            }
+        }
+        return options.editSamples > 0 && options.viewSamples > 0;
+    }
+
+    // visible cells of the layer view at a zoom factor, centered on (centerX, centerY)
+    void GetViewCells(float scale, int centerX, int centerY, int& left, int& top,
+        int& width, int& height)
+    {
+        width = static_cast<int>(viewWidth / (tileSize * scale)) + 1;
+        height = static_cast<int>(viewHeight / (tileSize * scale)) + 1;
+        left = centerX - width / 2;
+        top = centerY - height / 2;
+    }
+
+    void RunCase(Benchmark& bench, const Options& options, int size, int layerCount)
+    {
+        std::mt19937 random(12345u + size * 31u + layerCount);
+        long long cells = static_cast<long long>(size) * size * layerCount;
+
+        // allocating the layers (chunks stay unallocated until painted)
+        Benchmark::Result* result = &bench.Run("add_layer", size, layerCount, 20, [&]() {
+            MapModel model;
+            for (int i = 0; i < layerCount; ++i) model.AddLayer(size, size);
+        });
+        result->itemsPerCall = layerCount;
+        result->itemName = "layers";
+        bench.PrintResult(*result);
+
+        MapModel model;
+        model.SetAtlasLayout(atlasColumns, tileSize);
+        MapGenerator::Settings settings;
+        settings.width = size;
+        settings.height = size;
+        settings.layerCount = layerCount;
+        settings.density = options.density;
+        settings.collisionDensity = options.collisionDensity;
+        settings.tileCount = tileCount;
+        settings.seed = random();
+        result = &bench.Run("generate", size, layerCount, 1, [&]() {
+            MapGenerator::Generate(model, settings);
+        });
+        result->itemsPerCall = static_cast<double>(cells);
+        result->itemName = "cells";
+        bench.PrintResult(*result);
+
+        // 4x4 stamps at random cells, one undo step each like a single click
+        MapModel::Stamp stamp;
+        stamp.width = 4;
+        stamp.height = 4;
+        std::uniform_int_distribution<int> tile(0, tileCount - 1);
+        for (int i = 0; i < stamp.width * stamp.height; ++i) {
+            stamp.cells.push_back(TileCell::Make(tile(random)));
+        }
+        std::uniform_int_distribution<int> cell(0, size - 1);
+        std::uniform_int_distribution<int> layer(0, layerCount - 1);
+        result = &bench.Run("place_stamp", size, layerCount, options.editSamples, [&]() {
+            model.BeginEdit();
+            model.PlaceStamp(stamp, layer(random), cell(random), cell(random));
+            model.EndEdit();
+        });
+        result->itemsPerCall = stamp.width * stamp.height;
+        result->itemName = "tiles";
+        bench.PrintResult(*result);
+
+        result = &bench.Run("remove_tile", size, layerCount, options.editSamples, [&]() {
+            model.BeginEdit();
+            model.SetCell(layer(random), cell(random), cell(random), TileCell::Empty);
+            model.EndEdit();
+        });
+        bench.PrintResult(*result);
+        model.GetUndoStack().Clear();
+
+        // cold tile meshes for the view at random pan positions, every layer
+        std::vector<TileMeshCache> tileMeshes(layerCount);
+        size_t quads = 0;
+        result = &bench.Run("render_list", size, layerCount, options.viewSamples, [&]() {
+            int left, top, width, height;
+            GetViewCells(1.f, cell(random), cell(random), left, top, width, height);
+            for (int i = 0; i < layerCount; ++i) {
+                tileMeshes[i].Invalidate();
+                quads += tileMeshes[i].Update(model.GetLayers()[i].layer, atlasColumns,
+                    static_cast<float>(tileSize), left, top, width, height) / 4;
+            }
+        });
+        result->itemsPerCall = static_cast<double>(quads) / options.viewSamples;
+        result->itemName = "quads";
+        bench.PrintResult(*result);
+
+        // zoom in and out around the center with warm tile meshes: zooming is a
+        // transform change, so a step only builds the chunks it newly reveals
+        const float zoomStep = 1.25f;
+        float scale = 1.f;
+        float direction = zoomStep;
+        for (TileMeshCache& tileMesh : tileMeshes) tileMesh.Invalidate();
+        result = &bench.Run("zoom", size, layerCount, options.viewSamples, [&]() {
+            scale *= direction;
+            if (scale >= 4.f || scale <= 0.25f) direction = 1.f / direction;
+            int left, top, width, height;
+            GetViewCells(scale, size / 2, size / 2, left, top, width, height);
+            for (int i = 0; i < layerCount; ++i) {
+                tileMeshes[i].Update(model.GetLayers()[i].layer, atlasColumns,
+                    static_cast<float>(tileSize), left, top, width, height);
+            }
+        });
+        bench.PrintResult(*result);
+        tileMeshes.clear();
+
+        // greedy collision rectangles of every layer from scratch, then single cell
+        // toggles that only remesh the chunk they land in
+        std::vector<CollisionMesh> collisionMeshes(layerCount);
+        result = &bench.Run("collision_mesh", size, layerCount, 5, [&]() {
+            for (int i = 0; i < layerCount; ++i) {
+                collisionMeshes[i].Invalidate();
+                collisionMeshes[i].Update(model.GetLayers()[i].collisionGrid,
+                    0, 0, size, size);
+            }
+        });
+        result->itemsPerCall = static_cast<double>(cells);
+        result->itemName = "cells";
+        bench.PrintResult(*result);
+
+        result = &bench.Run("collision_edit", size, layerCount, options.editSamples, [&]() {
+            int index = layer(random);
+            int x = cell(random);
+            int y = cell(random);
+            model.SetCollision(index, x, y, !model.GetLayers()[index].collisionGrid.Get(x, y));
+            collisionMeshes[index].Update(model.GetLayers()[index].collisionGrid, x, y, 1, 1);
+        });
+        bench.PrintResult(*result);
+        model.GetUndoStack().Clear();
+        collisionMeshes.clear();
+
+        // save and load in every format, throughput in bytes of the written file
+        std::filesystem::path directory = options.directory.empty()
+            ? std::filesystem::temp_directory_path() : std::filesystem::path(options.directory);
+        struct Format {
+            const char* name;
+            const char* extension;
+            long long maxCells;
+        };
+        const Format formats[] = {
+            { "json", ".json", options.maxJsonCells },
+            { "binary", ".tmb", options.maxBinaryCells }
+        };
+        for (const Format& format : formats) {
+            std::string saveName = std::string("save_") + format.name;
+            std::string loadName = std::string("load_") + format.name;
+            if (cells > format.maxCells) {
+                bench.Skip(saveName, size, layerCount);
+                bench.Skip(loadName, size, layerCount);
+                continue;
+            }
+            std::string filename = (directory / ("tilemapbench" + std::string(format.extension)))
+                .string();
+            int samples = static_cast<int>(std::max(1LL, std::min(5LL, (1LL << 22) / cells)));
+            bool succeeded = true;
+            result = &bench.Run(saveName, size, layerCount, samples, [&]() {
+                succeeded = model.SaveTileMap(filename) && succeeded;
+            });
+            std::error_code error;
+            double bytes = static_cast<double>(std::filesystem::file_size(filename, error));
+            result->itemsPerCall = error ? 0.0 : bytes;
+            result->itemName = "bytes";
+            bench.PrintResult(*result);
+
+            result = &bench.Run(loadName, size, layerCount, samples, [&]() {
+                MapModel loaded;
+                loaded.SetAtlasLayout(atlasColumns, tileSize);
+                succeeded = loaded.LoadTileMap(filename) && succeeded;
+            });
+            result->itemsPerCall = error ? 0.0 : bytes;
+            result->itemName = "bytes";
+            bench.PrintResult(*result);
+            std::filesystem::remove(filename, error);
+            if (!succeeded) std::cerr << "Saving or loading " << format.name << " failed\n";
+        }
+    }
+    // checksum of every cell and collision bit, equal maps give equal checksums
+    std::uint64_t HashMap(const MapModel& map)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](std::uint64_t value) {
+            hash ^= value;
+            hash *= 1099511628211ull;
+        };
+        for (const MapModel::Layer& layer : map.GetLayers()) {
+            mix(static_cast<std::uint64_t>(layer.width) << 32
+                | static_cast<std::uint32_t>(layer.height));
+            std::vector<TileCell::Id> row(layer.width);
+            for (int y = 0; y < layer.height; ++y) {
+                if (layer.width > 0) layer.layer.ReadRow(0, y, layer.width, row.data());
+                for (TileCell::Id cell : row) mix(cell);
+                const auto* words = layer.collisionGrid.GetRow(y);
+                for (int i = 0; i < layer.collisionGrid.GetWordsPerRow(); ++i) mix(words[i]);
+            }
+        }
+        return hash;
+    }
+
+    int RunGenerate(int argc, char** argv)
+    {
+        if (argc < 2 || argv[1][0] == '-') {
+            PrintUsage();
+            return 1;
+        }
+        std::string filename = argv[1];
+        MapGenerator::Settings settings;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--size") settings.width = settings.height = std::atoi(value.c_str());
+            else if (arg == "--width") settings.width = std::atoi(value.c_str());
+            else if (arg == "--height") settings.height = std::atoi(value.c_str());
+            else if (arg == "--layers") settings.layerCount = std::atoi(value.c_str());
+            else if (arg == "--density") settings.density = std::atof(value.c_str());
+            else if (arg == "--collision") settings.collisionDensity = std::atof(value.c_str());
+            else if (arg == "--tiles") settings.tileCount = std::atoi(value.c_str());
+            else if (arg == "--seed") {
+                settings.seed = static_cast<std::uint32_t>(
+                    std::strtoul(value.c_str(), nullptr, 10));
+            }
+            else if (arg == "--distribution") {
+                if (!MapGenerator::ParseDistribution(value, settings.distribution)) {
+                    std::cerr << "Unknown distribution: " << value << "\n";
+                    return 1;
+                }
+            }
+            else {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return 1;
+            }
+        }
+        if (settings.width <= 0 || settings.height <= 0 || settings.layerCount <= 0
+            || settings.tileCount <= 0)
+        {
+            std::cerr << "Size, layer and tile counts must be positive\n";
+            return 1;
+        }
+
+        MapModel map;
+        map.SetAtlasLayout(atlasColumns, tileSize);
+        MapGenerator::Generate(map, settings);
+        if (!map.SaveTileMap(filename)) return 1;
+        std::cout << "Wrote " << settings.layerCount << " layers of " << settings.width << "x"
+            << settings.height << " to " << filename << " (checksum " << std::hex
+            << HashMap(map) << std::dec << ")\n";
+        return 0;
+    }
+
+    int RunReplay(int argc, char** argv)
+    {
+        if (argc < 2 || argv[1][0] == '-') {
+            PrintUsage();
+            return 1;
+        }
+        std::string logFilename = argv[1];
+        std::string mapFilename;
+        std::string output = "replay_results.json";
+        bool render = false;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--render") {
+                render = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--map") mapFilename = value;
+            else if (arg == "--out") output = value;
+            else {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return 1;
+            }
+        }
+
+        EditLog log;
+        if (!log.Load(logFilename)) return 1;
+        MapModel map;
+        map.SetAtlasLayout(atlasColumns, tileSize);
+        if (!mapFilename.empty() && !map.LoadTileMap(mapFilename)) return 1;
+        EditPlayer player(map);
+        // the editor selects the first layer of a loaded map
+        if (!map.GetLayers().empty()) {
+            EditLog::Event select;
+            select.type = EditLog::SelectLayer;
+            player.Apply(select);
+        }
+
+        // one timed sample per event, grouped by event type
+        std::vector<std::vector<double>> samples(EditLog::EventTypeCount);
+        std::vector<double> renderSamples;
+        std::vector<TileMeshCache> tileMeshes;
+        auto total = std::chrono::steady_clock::now();
+        for (const EditLog::Event& event : log.GetEvents()) {
+            auto start = std::chrono::steady_clock::now();
+            player.Apply(event);
+            auto end = std::chrono::steady_clock::now();
+            samples[event.type].push_back(
+                std::chrono::duration<double, std::micro>(end - start).count());
+            if (!render) continue;
+
+            // what the layer view would draw after the event, like a frame
+            start = std::chrono::steady_clock::now();
+            const std::vector<MapModel::Layer>& layers = map.GetLayers();
+            tileMeshes.resize(layers.size());
+            float cellSize = tileSize * player.GetScale();
+            int left = static_cast<int>(std::floor(player.GetViewX() / cellSize));
+            int top = static_cast<int>(std::floor(player.GetViewY() / cellSize));
+            int width = static_cast<int>(viewWidth / cellSize) + 2;
+            int height = static_cast<int>(viewHeight / cellSize) + 2;
+            for (size_t i = 0; i < layers.size(); ++i) {
+                tileMeshes[i].Update(layers[i].layer, atlasColumns,
+                    static_cast<float>(tileSize), left, top, width, height);
+            }
+            end = std::chrono::steady_clock::now();
+            renderSamples.push_back(
+                std::chrono::duration<double, std::micro>(end - start).count());
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()
+            - total).count();
+
+        Benchmark bench;
+        int mapSize = map.GetLayers().empty() ? 0 : map.GetLayers()[0].width;
+        int layerCount = static_cast<int>(map.GetLayers().size());
+        for (int type = 0; type < EditLog::EventTypeCount; ++type) {
+            if (samples[type].empty()) continue;
+            const char* name = EditLog::GetTypeName(static_cast<EditLog::EventType>(type));
+            Benchmark::Result& result = bench.AddResult(std::string("replay_") + name,
+                mapSize, layerCount);
+            result.samples = std::move(samples[type]);
+            result.itemName = "events";
+            result.peakRssBytes = Benchmark::GetPeakRss();
+            bench.PrintResult(result);
+        }
+        if (!renderSamples.empty()) {
+            Benchmark::Result& result = bench.AddResult("replay_render", mapSize, layerCount);
+            result.samples = std::move(renderSamples);
+            result.itemName = "frames";
+            result.peakRssBytes = Benchmark::GetPeakRss();
+            bench.PrintResult(result);
+        }
+        size_t eventCount = log.GetEvents().size();
+        std::cout << "Replayed " << eventCount << " events ("
+            << (log.GetEvents().empty() ? 0 : log.GetEvents().back().time) / 1000.0
+            << " s recorded) in " << seconds << " s, "
+            << (seconds > 0.0 ? eventCount / seconds : 0.0) << " events/s, checksum " << std::hex << HashMap(map) << std::dec << "\n";
+        if (!bench.WriteJson(output)) return 1;
+        std::cout << "Results written to " << output << "\n";
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "generate") return RunGenerate(argc - 1, argv + 1);
+    if (command == "replay") return RunReplay(argc - 1, argv + 1);
+
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    Benchmark bench;
+    for (int size : options.sizes) {
+        for (int layerCount : options.layerCounts) {
+            RunCase(bench, options, size, layerCount);
+        }
+    }
+    if (!bench.WriteJson(options.output)) return 1;
+    std::cout << "Results written to " << options.output << "\n";
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "autosaver.h"
+#include <chrono>
+
+AutoSaver::AutoSaver()
+{
+    worker = std::thread(&AutoSaver::WorkerLoop, this);
+}
+
+AutoSaver::~AutoSaver()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    condition.notify_one();
+    worker.join();
+}
+
+void AutoSaver::Submit(const std::string& target, Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // a newer snapshot of the same file makes the queued one pointless
+        bool replaced = false;
+        for (auto& pending : queue) {
+            if (pending.target == target) {
+                pending.job = std::move(job);
+                replaced = true;
+                break;
+            }
+        }
+        if (!replaced) queue.push_back({ target, std::move(job) });
+    }
+    condition.notify_one();
+}
+
+bool AutoSaver::PollResult(Result& result)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (results.empty()) return false;
+    result = results.front();
+    results.erase(results.begin());
+    return true;
+}
+
+bool AutoSaver::IsBusy()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return isRunning || !queue.empty();
+}
+
+bool AutoSaver::HasResults()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !results.empty();
+}
+
+void AutoSaver::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this] { return isStopping || !queue.empty(); });
+        // the queue is drained before stopping
+        if (queue.empty()) return;
+        PendingJob pending = std::move(queue.front());
+        queue.pop_front();
+        isRunning = true;
+
+        // the job runs unlocked so new jobs can be queued meanwhile
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        Result result;
+        result.target = pending.target;
+        result.succeeded = pending.job();
+        result.seconds = std::chrono::duration<float>(
+            std::chrono::steady_clock::now() - start).count();
+        pending.job = nullptr;  // release the snapshot before reporting back
+        lock.lock();
+
+        isRunning = false;
+        results.push_back(std::move(result));
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef AUTOSAVER_H
+#define AUTOSAVER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*  runs save jobs on a worker thread so writing a map never blocks the render loop.
+    a job is a self-contained closure (it owns a snapshot of the map), the editor keeps
+    editing while it runs. jobs for the same target that haven't started yet are
+    replaced by the newer one, finished jobs are handed back to the main thread
+    through PollResult()
+*/
+class AutoSaver {
+public:
+    using Job = std::function<bool()>;
+
+    struct Result {
+        std::string target;     // filename the job was writing
+        bool succeeded = false;
+        float seconds = 0.f;    // time the job took on the worker
+    };
+
+    AutoSaver();
+    // finishes the queued jobs before returning so nothing is lost on exit
+    ~AutoSaver();
+    AutoSaver(const AutoSaver&) = delete;
+    AutoSaver& operator=(const AutoSaver&) = delete;
+
+    void Submit(const std::string& target, Job job);
+    // pops one finished job, returns false when there is none
+    bool PollResult(Result& result);
+    // true while a job is queued or running
+    bool IsBusy();
+    // true while a finished job waits to be picked up by PollResult()
+    bool HasResults();
+
+private:
+    struct PendingJob {
+        std::string target;
+        Job job;
+    };
+
+    void WorkerLoop();
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<PendingJob> queue;
+    std::vector<Result> results;
+    bool isRunning = false;     // worker is executing a job
+    bool isStopping = false;
+    std::thread worker;         // started last, after the state it uses
+};
+
+#endif // !AUTOSAVER_H
@@ -0,0 +1,228 @@
+#include "bitgrid.h"
+#include <algorithm>
+
+namespace {
+    // mask with the lowest count bits set (count in [0, 64])
+    BitGrid::Word LowMask(int count)
+    {
+        return count >= BitGrid::WordBits ? ~BitGrid::Word(0)
+            : (BitGrid::Word(1) << count) - 1;
+    }
+}
+
+BitGrid::BitGrid(int width, int height)
+    : width(width), height(height)
+{
+    wordsPerRow = (width + WordBits - 1) / WordBits;
+    words.assign(static_cast<size_t>(wordsPerRow) * height, 0);
+}
+
+int BitGrid::PopCount(Word word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    // portable SWAR popcount
+    word = word - ((word >> 1) & 0x5555555555555555ull);
+    word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<int>((word * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+int BitGrid::CountTrailingZeros(Word word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    // isolate the lowest set bit and count the bits below it
+    return PopCount((word & (~word + 1)) - 1);
+#endif
+}
+
+BitGrid::Word BitGrid::LastWordMask() const
+{
+    int usedBits = width - (wordsPerRow - 1) * WordBits;
+    return LowMask(usedBits);
+}
+
+BitGrid::Word BitGrid::ReadBits(const Word* row, int bit, int count)
+{
+    int wordIndex = bit / WordBits;
+    int offset = bit % WordBits;
+    Word bits = row[wordIndex] >> offset;
+    // the range straddles two words, pull the high part from the next one
+    if (offset != 0 && offset + count > WordBits) {
+        bits |= row[wordIndex + 1] << (WordBits - offset);
+    }
+    return bits & LowMask(count);
+}
+
+void BitGrid::WriteBits(Word* row, int bit, int count, Word bits)
+{
+    int wordIndex = bit / WordBits;
+    int offset = bit % WordBits;
+    Word mask = LowMask(count);
+    bits &= mask;
+    row[wordIndex] = (row[wordIndex] & ~(mask << offset)) | (bits << offset);
+    if (offset != 0 && offset + count > WordBits) {
+        Word highMask = LowMask(offset + count - WordBits);
+        row[wordIndex + 1] = (row[wordIndex + 1] & ~highMask)
+            | (bits >> (WordBits - offset));
+    }
+}
+
+void BitGrid::FillRow(int y, int startX, int endX, bool value)
+{
+    if (y < 0 || y >= height) return;
+    startX = std::max(startX, 0);
+    endX = std::min(endX, width);
+    if (startX >= endX) return;
+
+    Word* row = GetRow(y);
+    int firstWord = startX / WordBits;
+    int lastWord = (endX - 1) / WordBits;
+    Word firstMask = ~Word(0) << (startX % WordBits);
+    Word lastMask = LowMask((endX - 1) % WordBits + 1);
+    if (firstWord == lastWord) firstMask &= lastMask;
+
+    // partial words at both ends, whole words in between
+    if (value) row[firstWord] |= firstMask;
+    else row[firstWord] &= ~firstMask;
+    if (firstWord == lastWord) return;
+    std::fill(row + firstWord + 1, row + lastWord, value ? ~Word(0) : Word(0));
+    if (value) row[lastWord] |= lastMask;
+    else row[lastWord] &= ~lastMask;
+}
+
+void BitGrid::FillRect(int left, int top, int width, int height, bool value)
+{
+    int endY = std::min(top + height, this->height);
+    for (int y = std::max(top, 0); y < endY; ++y) {
+        FillRow(y, left, left + width, value);
+    }
+}
+
+void BitGrid::Clear()
+{
+    std::fill(words.begin(), words.end(), Word(0));
+}
+
+void BitGrid::Resize(int newWidth, int newHeight)
+{
+    int newWordsPerRow = (newWidth + WordBits - 1) / WordBits;
+    if (newWordsPerRow != wordsPerRow) {
+        // the row stride changes, so the rows have to be moved into a new array
+        std::vector<Word> newWords(static_cast<size_t>(newWordsPerRow) * newHeight, 0);
+        int keptWords = std::min(wordsPerRow, newWordsPerRow);
+        for (int y = 0; y < std::min(height, newHeight); ++y) {
+            std::copy_n(GetRow(y), keptWords, newWords.data()
+                + static_cast<size_t>(y) * newWordsPerRow);
+        }
+        words = std::move(newWords);
+        wordsPerRow = newWordsPerRow;
+    }
+    else {
+        words.resize(static_cast<size_t>(wordsPerRow) * newHeight, 0);
+    }
+    int oldWidth = width;
+    width = newWidth;
+    height = newHeight;
+    // keep the padding bits past the new row end cleared
+    if (newWidth < oldWidth && wordsPerRow > 0) {
+        Word mask = LastWordMask();
+        for (int y = 0; y < height; ++y) GetRow(y)[wordsPerRow - 1] &= mask;
+    }
+}
+
+void BitGrid::CopyRect(const BitGrid& source, int srcLeft, int srcTop, int width,
+    int height, int dstLeft, int dstTop)
+{
+    // copying inside the same grid may overlap, so go through a temporary
+    if (&source == this) {
+        BitGrid temp(std::max(width, 0), std::max(height, 0));
+        temp.CopyRect(source, srcLeft, srcTop, width, height, 0, 0);
+        CopyRect(temp, 0, 0, width, height, dstLeft, dstTop);
+        return;
+    }
+
+    // clip the rectangle against both grids
+    if (srcLeft < 0) { width += srcLeft; dstLeft -= srcLeft; srcLeft = 0; }
+    if (srcTop < 0) { height += srcTop; dstTop -= srcTop; srcTop = 0; }
+    if (dstLeft < 0) { width += dstLeft; srcLeft -= dstLeft; dstLeft = 0; }
+    if (dstTop < 0) { height += dstTop; srcTop -= dstTop; dstTop = 0; }
+    width = std::min({ width, source.width - srcLeft, this->width - dstLeft });
+    height = std::min({ height, source.height - srcTop, this->height - dstTop });
+    if (width <= 0 || height <= 0) return;
+
+    for (int y = 0; y < height; ++y) {
+        const Word* srcRow = source.GetRow(srcTop + y);
+        Word* dstRow = GetRow(dstTop + y);
+        // move the row 64 cells at a time regardless of bit alignment
+        for (int x = 0; x < width; x += WordBits) {
+            int count = std::min(WordBits, width - x);
+            WriteBits(dstRow, dstLeft + x, count, ReadBits(srcRow, srcLeft + x, count));
+        }
+    }
+}
+
+size_t BitGrid::Count() const
+{
+    // padding bits are always zero, so whole words can be counted
+    size_t count = 0;
+    for (Word word : words) count += PopCount(word);
+    return count;
+}
+
+size_t BitGrid::CountRect(int left, int top, int width, int height) const
+{
+    int startX = std::max(left, 0);
+    int endX = std::min(left + width, this->width);
+    int startY = std::max(top, 0);
+    int endY = std::min(top + height, this->height);
+    size_t count = 0;
+    for (int y = startY; y < endY; ++y) {
+        const Word* row = GetRow(y);
+        for (int x = startX; x < endX; x += WordBits) {
+            count += PopCount(ReadBits(row, x, std::min(WordBits, endX - x)));
+        }
+    }
+    return count;
+}
+
+template <typename Op>
+void BitGrid::Combine(const BitGrid& other, Op op)
+{
+    int rows = std::min(height, other.height);
+    int columns = std::min(width, other.width);
+    if (rows <= 0 || columns <= 0) return;
+
+    int combinedWords = (columns + WordBits - 1) / WordBits;
+    // only the overlapping bits of the last word may change
+    Word lastMask = LowMask(columns - (combinedWords - 1) * WordBits);
+    for (int y = 0; y < rows; ++y) {
+        Word* row = GetRow(y);
+        const Word* otherRow = other.GetRow(y);
+        for (int w = 0; w < combinedWords - 1; ++w) {
+            row[w] = op(row[w], otherRow[w]);
+        }
+        Word& last = row[combinedWords - 1];
+        last = (last & ~lastMask)
+            | (op(last, otherRow[combinedWords - 1]) & lastMask);
+    }
+}
+
+void BitGrid::And(const BitGrid& other)
+{
+    Combine(other, [](Word a, Word b) { return a & b; });
+}
+
+void BitGrid::Or(const BitGrid& other)
+{
+    Combine(other, [](Word a, Word b) { return a | b; });
+}
+
+void BitGrid::Xor(const BitGrid& other)
+{
+    Combine(other, [](Word a, Word b) { return a ^ b; });
+}
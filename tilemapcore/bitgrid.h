@@ -0,0 +1,115 @@
+#ifndef BITGRID_H
+#define BITGRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*  dense 2D bitset stored as one contiguous array of 64 bit words:
+    every row starts on a word boundary (wordsPerRow words per row) and the unused
+    bits at the end of each row are always kept at zero, so fills, copies, counts and
+    boolean combines can work a whole word (64 cells) at a time
+*/
+class BitGrid {
+public:
+    using Word = std::uint64_t;
+    static constexpr int WordBits = 64;
+
+    BitGrid() = default;
+    BitGrid(int width, int height);
+
+    // single cell access, coordinates must be inside the grid
+    bool Get(int x, int y) const
+    {
+        return (words[Index(x, y)] >> (x % WordBits)) & 1u;
+    }
+    void Set(int x, int y, bool value)
+    {
+        Word bit = Word(1) << (x % WordBits);
+        if (value) words[Index(x, y)] |= bit;
+        else words[Index(x, y)] &= ~bit;
+    }
+
+    // bulk operations, ranges are clipped to the grid
+    void FillRow(int y, int startX, int endX, bool value);    // cells [startX, endX)
+    void FillRect(int left, int top, int width, int height, bool value);
+    void Clear();
+    // changes the dimensions keeping the cells that are still inside, growing only
+    // the height appends rows so it is cheap to do row by row
+    void Resize(int width, int height);
+    // copies a rectangle of source (at srcLeft/srcTop) into this grid at dstLeft/dstTop
+    void CopyRect(const BitGrid& source, int srcLeft, int srcTop, int width, int height,
+        int dstLeft, int dstTop);
+
+    size_t Count() const;
+    size_t CountRect(int left, int top, int width, int height) const;
+
+    // combine with another grid cell by cell over the overlapping area,
+    // cells outside the other grid are left unchanged
+    void And(const BitGrid& other);
+    void Or(const BitGrid& other);
+    void Xor(const BitGrid& other);
+
+    // calls fn(x, y) for every set cell in [startX, endX) x [startY, endY),
+    // whole empty words are skipped
+    template <typename Fn>
+    void ForEachSetBit(int startX, int startY, int endX, int endY, Fn&& fn) const;
+
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+    int GetWordsPerRow() const { return wordsPerRow; }
+    // raw row access for serialization
+    const Word* GetRow(int y) const { return words.data() + static_cast<size_t>(y) * wordsPerRow; }
+    Word* GetRow(int y) { return words.data() + static_cast<size_t>(y) * wordsPerRow; }
+
+    static int PopCount(Word word);
+    static int CountTrailingZeros(Word word);   // word must not be zero
+
+private:
+    size_t Index(int x, int y) const
+    {
+        return static_cast<size_t>(y) * wordsPerRow + x / WordBits;
+    }
+    // mask of the valid bits in the last word of a row
+    Word LastWordMask() const;
+    // read/write up to 64 bits starting at an arbitrary bit offset in a row
+    static Word ReadBits(const Word* row, int bit, int count);
+    static void WriteBits(Word* row, int bit, int count, Word bits);
+    template <typename Op>
+    void Combine(const BitGrid& other, Op op);
+
+    int width = 0;
+    int height = 0;
+    int wordsPerRow = 0;
+    std::vector<Word> words;
+};
+
+template <typename Fn>
+void BitGrid::ForEachSetBit(int startX, int startY, int endX, int endY, Fn&& fn) const
+{
+    if (startX < 0) startX = 0;
+    if (startY < 0) startY = 0;
+    if (endX > width) endX = width;
+    if (endY > height) endY = height;
+    if (startX >= endX) return;
+    int firstWord = startX / WordBits;
+    int lastWord = (endX - 1) / WordBits;
+    // masks that drop the cells left of startX and right of endX
+    Word firstMask = ~Word(0) << (startX % WordBits);
+    Word lastMask = ~Word(0) >> (WordBits - 1 - (endX - 1) % WordBits);
+    for (int y = startY; y < endY; ++y) {
+        const Word* row = GetRow(y);
+        for (int w = firstWord; w <= lastWord; ++w) {
+            Word word = row[w];
+            if (w == firstWord) word &= firstMask;
+            if (w == lastWord) word &= lastMask;
+            // strip the lowest set bit each iteration until the word is empty
+            while (word) {
+                fn(w * WordBits + CountTrailingZeros(word), y);
+                word &= word - 1;
+            }
+        }
+    }
+}
+
+#endif // !BITGRID_H
@@ -0,0 +1,193 @@
+#include "chunkedgrid.h"
+#include <atomic>
+
+namespace {
+    // shared counter so a revision stamp never repeats, even across different grids
+    std::atomic<std::uint64_t> revisionCounter{ 0 };
+}
+
+ChunkedGrid::ChunkedGrid(int width, int height)
+    : width(width), height(height)
+{
+    // round up so partially covered chunks at the right/bottom edge still exist
+    chunksX = (width + ChunkSize - 1) / ChunkSize;
+    chunksY = (height + ChunkSize - 1) / ChunkSize;
+    chunks.resize(static_cast<size_t>(chunksX) * chunksY);
+    chunkRevisions.resize(chunks.size(), 0);
+}
+
+TileCell::Id ChunkedGrid::Get(int x, int y) const
+{
+    const Chunk* chunk = GetChunk(x / ChunkSize, y / ChunkSize);
+    if (!chunk) return TileCell::Empty;
+    return chunk->cells[(y % ChunkSize) * ChunkSize + (x % ChunkSize)];
+}
+
+void ChunkedGrid::Set(int x, int y, TileCell::Id cell)
+{
+    size_t chunkIndex = static_cast<size_t>(y / ChunkSize) * chunksX + (x / ChunkSize);
+    bool isEmpty = TileCell::IsEmpty(cell);
+    if (!chunks[chunkIndex]) {
+        // clearing a cell of an unallocated chunk is a no-op
+        if (isEmpty) return;
+        chunks[chunkIndex] = std::make_shared<Chunk>();
+    }
+
+    size_t cellIndex = (y % ChunkSize) * ChunkSize + (x % ChunkSize);
+    if (isEmpty) cell = TileCell::Empty;
+    if (chunks[chunkIndex]->cells[cellIndex] == cell) return;
+    Chunk* chunk = MakeUnique(chunkIndex);
+    bool wasEmpty = TileCell::IsEmpty(chunk->cells[cellIndex]);
+    chunk->cells[cellIndex] = cell;
+    Touch(chunkIndex);
+
+    // keep track of the filled cells so empty chunks can be released
+    if (wasEmpty && !isEmpty) ++chunk->filledCount;
+    else if (!wasEmpty && isEmpty && --chunk->filledCount == 0) chunks[chunkIndex].reset();
+}
+
+void ChunkedGrid::ReadRow(int x, int y, int count, TileCell::Id* out) const
+{
+    int chunkY = y / ChunkSize;
+    int localY = y % ChunkSize;
+    while (count > 0) {
+        // copy the part of the row that falls into one chunk
+        int chunkX = x / ChunkSize;
+        int localX = x % ChunkSize;
+        int span = std::min(count, ChunkSize - localX);
+        const Chunk* chunk = GetChunk(chunkX, chunkY);
+        if (chunk) {
+            std::copy_n(chunk->cells.data() + localY * ChunkSize + localX, span, out);
+        }
+        else {
+            std::fill_n(out, span, TileCell::Empty);
+        }
+        x += span;
+        out += span;
+        count -= span;
+    }
+}
+
+void ChunkedGrid::WriteRow(int x, int y, int count, const TileCell::Id* cells)
+{
+    int chunkY = y / ChunkSize;
+    int localY = y % ChunkSize;
+    while (count > 0) {
+        int chunkX = x / ChunkSize;
+        int localX = x % ChunkSize;
+        int span = std::min(count, ChunkSize - localX);
+        size_t chunkIndex = static_cast<size_t>(chunkY) * chunksX + chunkX;
+
+        // filled cell delta of this span decides whether the chunk is needed at all
+        int incoming = 0;
+        for (int i = 0; i < span; ++i) {
+            if (!TileCell::IsEmpty(cells[i])) ++incoming;
+        }
+        if (!chunks[chunkIndex] && incoming > 0) chunks[chunkIndex] = std::make_shared<Chunk>();
+        if (chunks[chunkIndex]) {
+            Chunk* chunk = MakeUnique(chunkIndex);
+            TileCell::Id* target = chunk->cells.data() + localY * ChunkSize + localX;
+            int outgoing = 0;
+            bool changed = false;
+            for (int i = 0; i < span; ++i) {
+                if (!TileCell::IsEmpty(target[i])) ++outgoing;
+                // empty cells are always stored as TileCell::Empty
+                TileCell::Id cell = TileCell::IsEmpty(cells[i]) ? TileCell::Empty : cells[i];
+                changed |= target[i] != cell;
+                target[i] = cell;
+            }
+            chunk->filledCount += incoming - outgoing;
+            if (changed) Touch(chunkIndex);
+            if (chunk->filledCount == 0) chunks[chunkIndex].reset();
+        }
+        x += span;
+        cells += span;
+        count -= span;
+    }
+}
+
+void ChunkedGrid::Clear()
+{
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (!chunks[i]) continue;
+        chunks[i].reset();
+        Touch(i);
+    }
+}
+
+void ChunkedGrid::Resize(int newWidth, int newHeight)
+{
+    int newChunksX = (newWidth + ChunkSize - 1) / ChunkSize;
+    int newChunksY = (newHeight + ChunkSize - 1) / ChunkSize;
+    if (newChunksX == chunksX) {
+        // same chunk columns, rows of chunk slots are simply added or dropped
+        chunks.resize(static_cast<size_t>(newChunksX) * newChunksY);
+        chunkRevisions.resize(chunks.size(), 0);
+    }
+    else {
+        std::vector<std::shared_ptr<Chunk>> newChunks(static_cast<size_t>(newChunksX) * newChunksY);
+        std::vector<std::uint64_t> newRevisions(newChunks.size(), 0);
+        for (int chunkY = 0; chunkY < std::min(chunksY, newChunksY); ++chunkY) {
+            for (int chunkX = 0; chunkX < std::min(chunksX, newChunksX); ++chunkX) {
+                size_t from = static_cast<size_t>(chunkY) * chunksX + chunkX;
+                size_t to = static_cast<size_t>(chunkY) * newChunksX + chunkX;
+                newChunks[to] = std::move(chunks[from]);
+                newRevisions[to] = chunkRevisions[from];
+            }
+        }
+        chunks = std::move(newChunks);
+        chunkRevisions = std::move(newRevisions);
+    }
+    chunksX = newChunksX;
+    chunksY = newChunksY;
+
+    // when shrinking, cells of the edge chunks that fall outside are cleared
+    if (newWidth < width || newHeight < height) {
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            if (!chunks[i]) continue;
+            int baseX = static_cast<int>(i % chunksX) * ChunkSize;
+            int baseY = static_cast<int>(i / chunksX) * ChunkSize;
+            if (baseX + ChunkSize <= newWidth && baseY + ChunkSize <= newHeight) continue;
+            Chunk* chunk = MakeUnique(i);
+            bool changed = false;
+            for (int y = 0; y < ChunkSize; ++y) {
+                for (int x = 0; x < ChunkSize; ++x) {
+                    if (baseX + x < newWidth && baseY + y < newHeight) continue;
+                    TileCell::Id& cell = chunk->cells[y * ChunkSize + x];
+                    if (TileCell::IsEmpty(cell)) continue;
+                    cell = TileCell::Empty;
+                    --chunk->filledCount;
+                    changed = true;
+                }
+            }
+            if (chunk->filledCount == 0) chunks[i].reset();
+            if (changed) Touch(i);
+        }
+    }
+    width = newWidth;
+    height = newHeight;
+}
+
+void ChunkedGrid::Touch(size_t chunkIndex)
+{
+    revision = revisionCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+    chunkRevisions[chunkIndex] = revision;
+}
+
+ChunkedGrid::Chunk* ChunkedGrid::MakeUnique(size_t chunkIndex)
+{
+    std::shared_ptr<Chunk>& chunk = chunks[chunkIndex];
+    // only this thread can add owners to a chunk, so a count of one can't go stale.
+    // a snapshot dropping its reference concurrently at worst costs an extra clone
+    if (chunk.use_count() > 1) chunk = std::make_shared<Chunk>(*chunk);
+    return chunk.get();
+}
+
+size_t ChunkedGrid::GetAllocatedChunkCount() const
+{
+    size_t count = 0;
+    for (const auto& chunk : chunks) {
+        if (chunk) ++count;
+    }
+    return count;
+}
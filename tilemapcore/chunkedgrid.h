@@ -0,0 +1,109 @@
+#ifndef CHUNKEDGRID_H
+#define CHUNKEDGRID_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "tilecell.h"
+
+/*  sparse grid of packed cells split into fixed size square chunks:
+    a chunk is only allocated when the first non-empty cell is written into it and
+    is freed again once its last cell is cleared, so memory (and everything that
+    walks the grid) scales with painted tiles instead of with the layer area.
+    every chunk slot carries a revision stamp that changes whenever one of its cells
+    changes, render caches compare stamps to find out what needs rebuilding.
+    copies share their chunks and a shared chunk is only cloned right before it is
+    written to (copy-on-write), so copying a grid costs one pointer per chunk slot and
+    a copy can be read on another thread while the original keeps being edited
+*/
+class ChunkedGrid {
+public:
+    static constexpr int ChunkSize = 32;                    // chunk width/height in cells
+    static constexpr int ChunkArea = ChunkSize * ChunkSize;
+
+    struct Chunk {
+        std::array<TileCell::Id, ChunkArea> cells{};    // row-major cells of the chunk
+        int filledCount = 0;                            // number of non-empty cells
+    };
+
+    ChunkedGrid() = default;
+    ChunkedGrid(int width, int height);
+    ChunkedGrid(const ChunkedGrid&) = default;
+    ChunkedGrid& operator=(const ChunkedGrid&) = default;
+    ChunkedGrid(ChunkedGrid&&) = default;
+    ChunkedGrid& operator=(ChunkedGrid&&) = default;
+
+    // cell access, coordinates must be inside the grid
+    TileCell::Id Get(int x, int y) const;
+    void Set(int x, int y, TileCell::Id cell);
+    // frees every chunk, the dimensions stay the same
+    void Clear();
+    // changes the dimensions keeping the cells that are still inside, growing the
+    // height only appends chunk slots so it is cheap to do row by row
+    void Resize(int width, int height);
+
+    // bulk row access for count cells starting at (x, y), the span must be inside
+    // the grid. chunks are copied span by span instead of cell by cell
+    void ReadRow(int x, int y, int count, TileCell::Id* out) const;
+    void WriteRow(int x, int y, int count, const TileCell::Id* cells);
+
+    // calls fn(x, y, cell) for every non-empty cell, skipping unallocated chunks
+    template <typename Fn>
+    void ForEachTile(Fn&& fn) const;
+
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+    int GetChunksX() const { return chunksX; }
+    int GetChunksY() const { return chunksY; }
+    // returns nullptr for chunks that hold no tiles
+    const Chunk* GetChunk(int chunkX, int chunkY) const
+    {
+        return chunks[static_cast<size_t>(chunkY) * chunksX + chunkX].get();
+    }
+    size_t GetAllocatedChunkCount() const;
+    // revision stamps are unique across all grids, 0 means "never written"
+    std::uint64_t GetChunkRevision(int chunkX, int chunkY) const
+    {
+        return chunkRevisions[static_cast<size_t>(chunkY) * chunksX + chunkX];
+    }
+    std::uint64_t GetRevision() const { return revision; }
+
+private:
+    int width = 0;
+    int height = 0;
+    int chunksX = 0;
+    int chunksY = 0;
+    std::vector<std::shared_ptr<Chunk>> chunks;     // row-major chunk slots, shared between copies
+    std::vector<std::uint64_t> chunkRevisions;      // last change stamp per chunk slot
+    std::uint64_t revision = 0;                     // last change stamp of the grid
+
+    void Touch(size_t chunkIndex);
+    // clones the chunk in a slot if another grid still shares it
+    Chunk* MakeUnique(size_t chunkIndex);
+};
+
+template <typename Fn>
+void ChunkedGrid::ForEachTile(Fn&& fn) const
+{
+    for (int chunkY = 0; chunkY < chunksY; ++chunkY) {
+        for (int chunkX = 0; chunkX < chunksX; ++chunkX) {
+            const Chunk* chunk = GetChunk(chunkX, chunkY);
+            if (!chunk) continue;
+            int baseX = chunkX * ChunkSize;
+            int baseY = chunkY * ChunkSize;
+            // clamp the last row/column of chunks to the grid size
+            int endX = std::min(ChunkSize, width - baseX);
+            int endY = std::min(ChunkSize, height - baseY);
+            for (int y = 0; y < endY; ++y) {
+                for (int x = 0; x < endX; ++x) {
+                    TileCell::Id cell = chunk->cells[y * ChunkSize + x];
+                    if (!TileCell::IsEmpty(cell)) fn(baseX + x, baseY + y, cell);
+                }
+            }
+        }
+    }
+}
+
+#endif // !CHUNKEDGRID_H
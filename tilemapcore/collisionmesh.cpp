@@ -0,0 +1,97 @@
+#include "collisionmesh.h"
+#include <algorithm>
+
+namespace {
+    // first cell at or after x in [x, width) whose bit equals value, width if none
+    int FindBit(const BitGrid::Word* row, int x, int width, bool value)
+    {
+        while (x < width) {
+            int wordIndex = x / BitGrid::WordBits;
+            BitGrid::Word word = value ? row[wordIndex] : ~row[wordIndex];
+            // drop the cells before x
+            word &= ~BitGrid::Word(0) << (x % BitGrid::WordBits);
+            if (word) {
+                return std::min(wordIndex * BitGrid::WordBits
+                    + BitGrid::CountTrailingZeros(word), width);
+            }
+            x = (wordIndex + 1) * BitGrid::WordBits;
+        }
+        return width;
+    }
+}
+
+void CollisionMesh::Build(const BitGrid& grid, int left, int top, int width, int height,
+    std::vector<Rect>& rects)
+{
+    int startX = std::max(left, 0);
+    int startY = std::max(top, 0);
+    width = std::min(left + width, grid.GetWidth()) - startX;
+    height = std::min(top + height, grid.GetHeight()) - startY;
+    if (width <= 0 || height <= 0) return;
+
+    // cells not covered by a rectangle yet, with the region moved to the origin
+    BitGrid remaining(width, height);
+    remaining.CopyRect(grid, startX, startY, width, height, 0, 0);
+    for (int y = 0; y < height; ++y) {
+        const BitGrid::Word* row = remaining.GetRow(y);
+        int x = FindBit(row, 0, width, true);
+        while (x < width) {
+            int end = FindBit(row, x, width, false);
+            int runWidth = end - x;
+            // grow down while the next row has the whole run, taking it from that row
+            int runHeight = 1;
+            while (y + runHeight < height
+                && remaining.CountRect(x, y + runHeight, runWidth, 1)
+                == static_cast<size_t>(runWidth))
+            {
+                remaining.FillRow(y + runHeight, x, end, false);
+                ++runHeight;
+            }
+            rects.push_back({ startX + x, startY + y, runWidth, runHeight });
+            x = FindBit(row, end, width, true);
+        }
+    }
+}
+
+bool CollisionMesh::Update(const BitGrid& grid, int left, int top, int width, int height)
+{
+    if (grid.GetWidth() != this->width || grid.GetHeight() != this->height) {
+        this->width = grid.GetWidth();
+        this->height = grid.GetHeight();
+        chunksX = (this->width + ChunkSize - 1) / ChunkSize;
+        chunksY = (this->height + ChunkSize - 1) / ChunkSize;
+        chunks.clear();
+    }
+    if (chunks.size() != static_cast<size_t>(chunksX) * chunksY) {
+        chunks.assign(static_cast<size_t>(chunksX) * chunksY, Chunk());
+    }
+    if (width <= 0 || height <= 0) return false;
+
+    int startChunkX = std::max(left / ChunkSize, 0);
+    int startChunkY = std::max(top / ChunkSize, 0);
+    int endChunkX = std::min((left + width - 1) / ChunkSize + 1, chunksX);
+    int endChunkY = std::min((top + height - 1) / ChunkSize + 1, chunksY);
+    bool hasChanged = false;
+    for (int chunkY = startChunkY; chunkY < endChunkY; ++chunkY) {
+        int baseY = chunkY * ChunkSize;
+        int rows = std::min(ChunkSize, this->height - baseY);
+        for (int chunkX = startChunkX; chunkX < endChunkX; ++chunkX) {
+            Chunk& chunk = chunks[static_cast<size_t>(chunkY) * chunksX + chunkX];
+            // a chunk is exactly one word wide, so comparing its rows is cheap
+            bool isSame = chunk.isBuilt;
+            for (int y = 0; y < rows && isSame; ++y) {
+                isSame = chunk.bits[y] == grid.GetRow(baseY + y)[chunkX];
+            }
+            if (isSame) continue;
+
+            chunk.bits.resize(rows);
+            for (int y = 0; y < rows; ++y) chunk.bits[y] = grid.GetRow(baseY + y)[chunkX];
+            chunk.rects.clear();
+            Build(grid, chunkX * ChunkSize, baseY, ChunkSize, rows, chunk.rects);
+            chunk.revision = nextRevision++;
+            chunk.isBuilt = true;
+            hasChanged = true;
+        }
+    }
+    return hasChanged;
+}
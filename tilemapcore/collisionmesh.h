@@ -0,0 +1,68 @@
+#ifndef COLLISIONMESH_H
+#define COLLISIONMESH_H
+
+#include <cstdint>
+#include <vector>
+#include "bitgrid.h"
+
+/*  collision as rectangles instead of cells: greedy meshing takes the first set cell of
+    a row, grows it into the longest run, then extends the run down for as long as the
+    rows below have every cell of it set. the rectangles cover each set cell exactly once
+    and a solid area becomes a handful of shapes instead of one per cell, which is what
+    both the overlay and game physics want.
+    the mesh keeps the rectangles per ChunkSize x ChunkSize chunk (one BitGrid word per
+    chunk row) with a copy of the chunk's bits, so Update() only remeshes chunks whose
+    cells changed, wherever the change came from (edits, undo, loading)
+*/
+class CollisionMesh {
+public:
+    static constexpr int ChunkSize = BitGrid::WordBits;
+
+    struct Rect {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
+    // greedy rectangles of the set cells in a region of grid (clipped to it), appended
+    // to rects. rectangles don't cross the region's border
+    static void Build(const BitGrid& grid, int left, int top, int width, int height,
+        std::vector<Rect>& rects);
+
+    // remeshes the chunks overlapping the cell region whose bits changed since their
+    // last update, returns true if any chunk was remeshed
+    bool Update(const BitGrid& grid, int left, int top, int width, int height);
+    // forces every chunk to be remeshed on the next update
+    void Invalidate() { chunks.clear(); }
+
+    int GetChunksX() const { return chunksX; }
+    int GetChunksY() const { return chunksY; }
+    // rectangles of an updated chunk, in grid cells
+    const std::vector<Rect>& GetChunkRects(int chunkX, int chunkY) const
+    {
+        return chunks[static_cast<size_t>(chunkY) * chunksX + chunkX].rects;
+    }
+    // changes every time the chunk is remeshed, for caches built from the rectangles
+    std::uint64_t GetChunkRevision(int chunkX, int chunkY) const
+    {
+        return chunks[static_cast<size_t>(chunkY) * chunksX + chunkX].revision;
+    }
+
+private:
+    struct Chunk {
+        std::vector<BitGrid::Word> bits;    // one word per row, as of the last remesh
+        std::vector<Rect> rects;
+        std::uint64_t revision = 0;
+        bool isBuilt = false;
+    };
+
+    std::vector<Chunk> chunks;  // row-major, one per chunk slot of the grid
+    int chunksX = 0;
+    int chunksY = 0;
+    int width = 0;
+    int height = 0;
+    std::uint64_t nextRevision = 1;
+};
+
+#endif // !COLLISIONMESH_H
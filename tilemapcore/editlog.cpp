@@ -0,0 +1,283 @@
+#include "editlog.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+    const char Magic[4] = { 'T', 'M', 'E', 'L' };
+    const std::uint8_t Version = 1;
+
+    void PutVarint(std::vector<char>& buffer, std::uint64_t value)
+    {
+        // 7 bits per byte, the high bit marks that more bytes follow
+        while (value >= 0x80) {
+            buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<char>(value));
+    }
+    void PutSigned(std::vector<char>& buffer, std::int64_t value)
+    {
+        // zigzag keeps small negative values small
+        PutVarint(buffer, (static_cast<std::uint64_t>(value) << 1)
+            ^ static_cast<std::uint64_t>(value >> 63));
+    }
+    void PutFloat(std::vector<char>& buffer, float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 4; ++i) {
+            buffer.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+        }
+    }
+
+    // reads from a loaded file, any read past the end marks the reader as failed
+    struct Reader {
+        const std::vector<char>& data;
+        size_t position = 0;
+        bool failed = false;
+
+        bool AtEnd() const { return position >= data.size(); }
+        std::uint8_t Byte()
+        {
+            if (position >= data.size()) {
+                failed = true;
+                return 0;
+            }
+            return static_cast<std::uint8_t>(data[position++]);
+        }
+        std::uint64_t Varint()
+        {
+            std::uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                std::uint8_t byte = Byte();
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return value;
+            }
+            failed = true;
+            return 0;
+        }
+        std::int64_t Signed()
+        {
+            std::uint64_t value = Varint();
+            return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+        }
+        float Float()
+        {
+            std::uint32_t bits = 0;
+            for (int i = 0; i < 4; ++i) bits |= static_cast<std::uint32_t>(Byte()) << (8 * i);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+    };
+}
+
+void EditLog::Start()
+{
+    events.clear();
+    isRecording = true;
+    start = std::chrono::steady_clock::now();
+    // the first RecordView always records, so the log starts with the full view
+    lastScale = 0.f;
+}
+
+EditLog::Event& EditLog::Append(EventType type)
+{
+    Event event;
+    event.type = type;
+    event.time = static_cast<std::uint32_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    events.push_back(std::move(event));
+    return events.back();
+}
+
+void EditLog::Record(EventType type, int layer, int x, int y, int value)
+{
+    if (!isRecording) return;
+    Event& event = Append(type);
+    event.layer = layer;
+    event.x = x;
+    event.y = y;
+    event.value = value;
+}
+
+void EditLog::RecordStamp(const MapModel::Stamp& stamp)
+{
+    if (!isRecording) return;
+    Append(SelectStamp).stamp = stamp;
+}
+
+void EditLog::RecordView(float viewX, float viewY, float scale)
+{
+    if (!isRecording) return;
+    if (viewX == lastViewX && viewY == lastViewY && scale == lastScale) return;
+    Event& event = Append(scale != lastScale ? Zoom : Pan);
+    event.viewX = viewX;
+    event.viewY = viewY;
+    event.scale = scale;
+    lastViewX = viewX;
+    lastViewY = viewY;
+    lastScale = scale;
+}
+
+bool EditLog::Save(const std::string& filename) const
+{
+    std::vector<char> buffer(Magic, Magic + 4);
+    buffer.push_back(static_cast<char>(Version));
+    std::uint32_t lastTime = 0;
+    for (const Event& event : events) {
+        buffer.push_back(static_cast<char>(event.type));
+        PutVarint(buffer, event.time - lastTime);
+        lastTime = event.time;
+        switch (event.type) {
+        case AddLayer:
+            PutVarint(buffer, static_cast<std::uint32_t>(event.x));
+            PutVarint(buffer, static_cast<std::uint32_t>(event.y));
+            break;
+        case SelectLayer:
+            PutSigned(buffer, event.layer);
+            break;
+        case SelectStamp:
+            PutVarint(buffer, static_cast<std::uint32_t>(event.stamp.width));
+            PutVarint(buffer, static_cast<std::uint32_t>(event.stamp.height));
+            PutSigned(buffer, event.stamp.originX);
+            PutSigned(buffer, event.stamp.originY);
+            for (TileCell::Id cell : event.stamp.cells) PutVarint(buffer, cell);
+            break;
+        case PlaceStamp:
+        case EraseTile:
+        case SetCollision:
+        case Fill:
+            PutSigned(buffer, event.layer);
+            PutSigned(buffer, event.x);
+            PutSigned(buffer, event.y);
+            if (event.type == SetCollision || event.type == Fill) {
+                buffer.push_back(static_cast<char>(event.value));
+            }
+            break;
+        case Pan:
+        case Zoom:
+            PutFloat(buffer, event.viewX);
+            PutFloat(buffer, event.viewY);
+            if (event.type == Zoom) PutFloat(buffer, event.scale);
+            break;
+        default:
+            break;
+        }
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file for writing: " << filename << "\n";
+        return false;
+    }
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.close();
+    if (file.fail()) {
+        std::cerr << "Failed to write edit log: " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool EditLog::Load(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file for reading: " << filename << "\n";
+        return false;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>());
+    if (data.size() < 5 || std::memcmp(data.data(), Magic, 4) != 0
+        || static_cast<std::uint8_t>(data[4]) != Version)
+    {
+        std::cerr << "Not a supported edit log: " << filename << "\n";
+        return false;
+    }
+
+    // parse into a separate list so a broken file leaves the current log untouched
+    std::vector<Event> loaded;
+    Reader reader{ data, 5 };
+    std::uint32_t time = 0;
+    while (!reader.AtEnd() && !reader.failed) {
+        Event event;
+        std::uint8_t type = reader.Byte();
+        if (type >= EventTypeCount) {
+            reader.failed = true;
+            break;
+        }
+        event.type = static_cast<EventType>(type);
+        time += static_cast<std::uint32_t>(reader.Varint());
+        event.time = time;
+        switch (event.type) {
+        case AddLayer:
+            event.x = static_cast<int>(reader.Varint());
+            event.y = static_cast<int>(reader.Varint());
+            break;
+        case SelectLayer:
+            event.layer = static_cast<int>(reader.Signed());
+            break;
+        case SelectStamp: {
+            MapModel::Stamp& stamp = event.stamp;
+            stamp.width = static_cast<int>(reader.Varint());
+            stamp.height = static_cast<int>(reader.Varint());
+            stamp.originX = static_cast<int>(reader.Signed());
+            stamp.originY = static_cast<int>(reader.Signed());
+            // a stamp can't be larger than the bytes left in the file
+            size_t count = static_cast<size_t>(stamp.width) * stamp.height;
+            if (stamp.width < 0 || stamp.height < 0
+                || count > data.size() - std::min(reader.position, data.size()))
+            {
+                reader.failed = true;
+                break;
+            }
+            stamp.cells.resize(count);
+            for (TileCell::Id& cell : stamp.cells) {
+                cell = static_cast<TileCell::Id>(reader.Varint());
+                if (TileCell::IsEmpty(cell)) stamp.hasHoles = true;
+            }
+            break;
+        }
+        case PlaceStamp:
+        case EraseTile:
+        case SetCollision:
+        case Fill:
+            event.layer = static_cast<int>(reader.Signed());
+            event.x = static_cast<int>(reader.Signed());
+            event.y = static_cast<int>(reader.Signed());
+            if (event.type == SetCollision || event.type == Fill) event.value = reader.Byte();
+            break;
+        case Pan:
+        case Zoom:
+            event.viewX = reader.Float();
+            event.viewY = reader.Float();
+            if (event.type == Zoom) event.scale = reader.Float();
+            break;
+        default:
+            break;
+        }
+        if (!reader.failed) loaded.push_back(std::move(event));
+    }
+    if (reader.failed) {
+        std::cerr << "Edit log is truncated or corrupt: " << filename << "\n";
+        return false;
+    }
+
+    events = std::move(loaded);
+    isRecording = false;
+    return true;
+}
+
+const char* EditLog::GetTypeName(EventType type)
+{
+    static const char* const names[EventTypeCount] = {
+        "add_layer", "select_layer", "select_stamp", "begin_stroke", "end_stroke",
+        "place_stamp", "erase_tile", "set_collision", "fill", "undo", "redo", "pan", "zoom"
+    };
+    return type < EventTypeCount ? names[type] : "unknown";
+}
@@ -0,0 +1,84 @@
+#ifndef EDITLOG_H
+#define EDITLOG_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapmodel.h"
+
+/*  recording of an editing session on the layer view: every edit is stored at the
+    cell level (which stamp went to which cell of which layer), together with the
+    selections, layer switches, pans and zooms in between, so EditPlayer can repeat
+    the session exactly without a window.
+    file format (.tml), little-endian:
+        char[4] magic = "TMEL", u8 version
+        per event: u8 type, varint milliseconds since the previous event, payload
+    payloads use unsigned varints for sizes and indices, zigzag varints for cells
+    (they can lie outside the layer) and raw f32 for view positions
+*/
+class EditLog {
+public:
+    enum EventType : std::uint8_t {
+        AddLayer,       // x = width, y = height
+        SelectLayer,    // layer
+        SelectStamp,    // stamp, the selection placed from now on
+        BeginStroke,    // everything until EndStroke is one undo step
+        EndStroke,
+        PlaceStamp,     // layer, x, y: the selected stamp with its origin on the cell
+        EraseTile,      // layer, x, y
+        SetCollision,   // layer, x, y, value = 0 or 1
+        Fill,           // layer, x, y, value = FillFlags
+        Undo,
+        Redo,
+        Pan,            // viewX, viewY = layer view offset in window pixels
+        Zoom,           // viewX, viewY, scale
+        EventTypeCount
+    };
+    enum FillFlags {
+        FillErase = 1,
+        FillCollision = 2
+    };
+
+    struct Event {
+        EventType type = BeginStroke;
+        std::uint32_t time = 0;     // milliseconds since the recording started
+        int layer = 0;
+        int x = 0;
+        int y = 0;
+        int value = 0;
+        float viewX = 0.f;
+        float viewY = 0.f;
+        float scale = 1.f;
+        MapModel::Stamp stamp;      // SelectStamp only
+    };
+
+    // recording clears the log, events are only kept while it runs
+    void Start();
+    void Stop() { isRecording = false; }
+    bool IsRecording() const { return isRecording; }
+
+    void Record(EventType type, int layer = 0, int x = 0, int y = 0, int value = 0);
+    void RecordStamp(const MapModel::Stamp& stamp);
+    // records a Pan or Zoom when the view differs from the last recorded one
+    void RecordView(float viewX, float viewY, float scale);
+
+    const std::vector<Event>& GetEvents() const { return events; }
+    bool Save(const std::string& filename) const;
+    bool Load(const std::string& filename);
+
+    static const char* GetTypeName(EventType type);
+
+private:
+    Event& Append(EventType type);
+
+    std::vector<Event> events;
+    bool isRecording = false;
+    std::chrono::steady_clock::time_point start;
+    // last recorded view, so a frame without movement records nothing
+    float lastViewX = 0.f;
+    float lastViewY = 0.f;
+    float lastScale = 0.f;
+};
+
+#endif // !EDITLOG_H
@@ -0,0 +1,67 @@
+#include "editplayer.h"
+
+void EditPlayer::Apply(const EditLog::Event& event)
+{
+    switch (event.type) {
+    case EditLog::AddLayer:
+        // a new layer becomes the active one, like in the editor
+        activeLayerIndex = map.AddLayer(event.x, event.y);
+        break;
+    case EditLog::SelectLayer:
+        if (event.layer >= 0 && event.layer < static_cast<int>(map.GetLayers().size())) {
+            activeLayerIndex = event.layer;
+        }
+        break;
+    case EditLog::SelectStamp:
+        stamp = event.stamp;
+        break;
+    case EditLog::BeginStroke:
+        map.BeginEdit();
+        break;
+    case EditLog::EndStroke:
+        map.EndEdit();
+        break;
+    case EditLog::PlaceStamp:
+        if (!stamp.cells.empty()) map.PlaceStamp(stamp, event.layer, event.x, event.y);
+        break;
+    case EditLog::EraseTile:
+        if (map.IsInside(event.layer, event.x, event.y)) {
+            map.SetCell(event.layer, event.x, event.y, TileCell::Empty);
+        }
+        break;
+    case EditLog::SetCollision:
+        if (map.IsInside(event.layer, event.x, event.y)) {
+            map.SetCollision(event.layer, event.x, event.y, event.value != 0);
+        }
+        break;
+    case EditLog::Fill: {
+        bool erase = (event.value & EditLog::FillErase) != 0;
+        map.BeginEdit();
+        if (event.value & EditLog::FillCollision) {
+            map.FillCollision(event.layer, event.x, event.y, !erase);
+        }
+        else {
+            map.FillTiles(event.layer, event.x, event.y, stamp, erase);
+        }
+        map.EndEdit();
+        break;
+    }
+    case EditLog::Undo:
+        map.Undo();
+        break;
+    case EditLog::Redo:
+        map.Redo();
+        break;
+    case EditLog::Zoom:
+        scale = event.scale;
+        viewX = event.viewX;
+        viewY = event.viewY;
+        break;
+    case EditLog::Pan:
+        viewX = event.viewX;
+        viewY = event.viewY;
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef EDITPLAYER_H
+#define EDITPLAYER_H
+
+#include "editlog.h"
+#include "mapmodel.h"
+
+/*  replays an EditLog against a map with the same calls the editor's TileMap makes
+    for each recorded action, as fast as possible and without a window. the view
+    state (pan and zoom) is tracked so callers can render or measure what the user
+    was looking at after each event
+*/
+class EditPlayer {
+public:
+    explicit EditPlayer(MapModel& map) : map(map) {}
+
+    void Apply(const EditLog::Event& event);
+
+    int GetActiveLayer() const { return activeLayerIndex; }
+    const MapModel::Stamp& GetStamp() const { return stamp; }
+    float GetViewX() const { return viewX; }
+    float GetViewY() const { return viewY; }
+    float GetScale() const { return scale; }
+
+private:
+    MapModel& map;
+    int activeLayerIndex = -1;
+    MapModel::Stamp stamp;
+    float viewX = 0.f;
+    float viewY = 0.f;
+    float scale = 1.f;
+};
+
+#endif // !EDITPLAYER_H
@@ -0,0 +1,62 @@
+#ifndef FLOODFILL_H
+#define FLOODFILL_H
+
+#include <utility>
+#include <vector>
+#include "bitgrid.h"
+
+/*  scanline flood fill: instead of visiting cells one by one (or recursing per cell)
+    the region is walked as horizontal spans. each popped seed is extended left and
+    right as far as the region goes, then one new seed is pushed per run of matching
+    cells on the rows above and below. the explicit stack holds seeds per run rather
+    than per cell, so even a 2048x2048 region never gets close to a stack overflow.
+    the grid itself isn't touched, the caller writes the returned spans in bulk
+*/
+namespace FloodFill {
+    struct Span {
+        int y;
+        int startX;     // first cell of the span
+        int endX;       // one past the last cell
+    };
+
+    // collects the 4-connected region around the seed where matches(x, y) holds,
+    // returns no spans if the seed is outside the grid or doesn't match
+    template <typename Match>
+    std::vector<Span> FindRegion(int width, int height, int seedX, int seedY, Match&& matches)
+    {
+        std::vector<Span> spans;
+        if (seedX < 0 || seedX >= width || seedY < 0 || seedY >= height
+            || !matches(seedX, seedY)) return spans;
+
+        // cells that already belong to a span, so nothing is scanned twice
+        BitGrid visited(width, height);
+        std::vector<std::pair<int, int>> seeds{ { seedX, seedY } };
+        while (!seeds.empty()) {
+            auto [x, y] = seeds.back();
+            seeds.pop_back();
+            if (visited.Get(x, y)) continue;
+
+            // grow the span in both directions
+            int startX = x;
+            while (startX > 0 && !visited.Get(startX - 1, y) && matches(startX - 1, y)) --startX;
+            int endX = x + 1;
+            while (endX < width && !visited.Get(endX, y) && matches(endX, y)) ++endX;
+            visited.FillRow(y, startX, endX, true);
+            spans.push_back({ y, startX, endX });
+
+            // one seed for every run of open cells directly above and below the span
+            for (int nextY : { y - 1, y + 1 }) {
+                if (nextY < 0 || nextY >= height) continue;
+                bool isInRun = false;
+                for (int nextX = startX; nextX < endX; ++nextX) {
+                    bool isOpen = !visited.Get(nextX, nextY) && matches(nextX, nextY);
+                    if (isOpen && !isInRun) seeds.push_back({ nextX, nextY });
+                    isInRun = isOpen;
+                }
+            }
+        }
+        return spans;
+    }
+}
+
+#endif // !FLOODFILL_H
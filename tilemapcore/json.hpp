@@ -8674,6 +8674,10 @@ scan_number_done:
                             token_type return_type)
     {
         JSON_ASSERT(char_traits<char_type>::to_char_type(current) == literal_text[0]);
+        // tilemap: start a new token like scan_string/scan_number do, otherwise the
+        // text of every literal (and the whitespace between them) piles up in
+        // token_string, which grows with the file for the collision grid's bools
+        reset();
         for (std::size_t i = 1; i < length; ++i)
         {
             if (JSON_HEDLEY_UNLIKELY(char_traits<char_type>::to_char_type(get()) != literal_text[i]))
@@ -0,0 +1,142 @@
+#include "jsonwriter.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+JsonWriter::JsonWriter(std::ostream& out, int indent)
+    : out(out), indent(indent)
+{
+}
+
+void JsonWriter::NewLine(size_t depth)
+{
+    size_t width = depth * static_cast<size_t>(indent);
+    if (spaces.size() < width) spaces.resize(width, ' ');
+    out.put('\n');
+    out.write(spaces.data(), static_cast<std::streamsize>(width));
+}
+
+void JsonWriter::BeforeValue()
+{
+    // object values follow their key directly
+    if (isAfterKey) {
+        isAfterKey = false;
+        return;
+    }
+    if (counts.empty()) return;
+    if (counts.back()++ > 0) out.put(',');
+    if (indent >= 0) NewLine(counts.size());
+}
+
+void JsonWriter::Open(char bracket)
+{
+    BeforeValue();
+    out.put(bracket);
+    counts.push_back(0);
+}
+
+void JsonWriter::Close(char bracket)
+{
+    size_t count = counts.back();
+    counts.pop_back();
+    // empty containers stay on one line, e.g. "[]"
+    if (count > 0 && indent >= 0) NewLine(counts.size());
+    out.put(bracket);
+}
+
+void JsonWriter::BeginObject() { Open('{'); }
+void JsonWriter::EndObject() { Close('}'); }
+void JsonWriter::BeginArray() { Open('['); }
+void JsonWriter::EndArray() { Close(']'); }
+
+void JsonWriter::Key(const char* key)
+{
+    // keys are separated like values, the value then continues on the same line
+    if (counts.back()++ > 0) out.put(',');
+    if (indent >= 0) NewLine(counts.size());
+    WriteEscaped(key, std::strlen(key));
+    if (indent >= 0) out.write(": ", 2);
+    else out.put(':');
+    isAfterKey = true;
+}
+
+void JsonWriter::Null()
+{
+    BeforeValue();
+    out.write("null", 4);
+}
+
+void JsonWriter::Bool(bool value)
+{
+    BeforeValue();
+    if (value) out.write("true", 4);
+    else out.write("false", 5);
+}
+
+void JsonWriter::Int(std::int64_t value)
+{
+    BeforeValue();
+    char buffer[24];
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+    out.write(buffer, end - buffer);
+}
+
+void JsonWriter::UInt(std::uint64_t value)
+{
+    BeforeValue();
+    char buffer[24];
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+    out.write(buffer, end - buffer);
+}
+
+void JsonWriter::Float(double value)
+{
+    BeforeValue();
+    // json has no representation for nan/inf, same as nlohmann they become null
+    if (!std::isfinite(value)) {
+        out.write("null", 4);
+        return;
+    }
+    // shortest representation that reads back to the same double
+    char buffer[32];
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+    out.write(buffer, end - buffer);
+    // keep it a float when read back, "1" becomes "1.0"
+    if (std::find_if(buffer, end, [](char c) { return c == '.' || c == 'e'; }) == end) {
+        out.write(".0", 2);
+    }
+}
+
+void JsonWriter::String(const std::string& value)
+{
+    BeforeValue();
+    WriteEscaped(value.data(), value.size());
+}
+
+void JsonWriter::WriteEscaped(const char* text, size_t length)
+{
+    static const char hex[] = "0123456789abcdef";
+    out.put('"');
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        switch (c) {
+        case '"': out.write("\\\"", 2); break;
+        case '\\': out.write("\\\\", 2); break;
+        case '\n': out.write("\\n", 2); break;
+        case '\r': out.write("\\r", 2); break;
+        case '\t': out.write("\\t", 2); break;
+        case '\b': out.write("\\b", 2); break;
+        case '\f': out.write("\\f", 2); break;
+        default:
+            if (c < 0x20) {
+                char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                out.write(escaped, 6);
+            }
+            else {
+                out.put(static_cast<char>(c));
+            }
+        }
+    }
+    out.put('"');
+}
@@ -0,0 +1,46 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*  incremental json writer: values are written straight to the stream as they come, so
+    nothing but the nesting stack is kept in memory. with an indent >= 0 the layout
+    matches nlohmann's dump(indent), with a negative indent the output is compact.
+    the caller is responsible for a well formed sequence (Key() before each object value)
+*/
+class JsonWriter {
+public:
+    explicit JsonWriter(std::ostream& out, int indent = -1);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    void Key(const char* key);
+
+    void Null();
+    void Bool(bool value);
+    void Int(std::int64_t value);
+    void UInt(std::uint64_t value);
+    void Float(double value);
+    void String(const std::string& value);
+
+private:
+    // writes the separator and indentation that go in front of the next value
+    void BeforeValue();
+    void Open(char bracket);
+    void Close(char bracket);
+    void NewLine(size_t depth);
+    void WriteEscaped(const char* text, size_t length);
+
+    std::ostream& out;
+    int indent;
+    std::vector<size_t> counts;    // number of values written at each open level
+    bool isAfterKey = false;
+    std::string spaces;             // reused indentation run
+};
+
+#endif // !JSONWRITER_H
@@ -0,0 +1,107 @@
+#include "mapgenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+    // the std:: distributions are implementation-defined, so every value is derived
+    // from the raw mt19937 output (which the standard pins down) by hand
+
+    // uniform in [0, 1) from the top 24 bits
+    double Chance(std::mt19937& random)
+    {
+        return static_cast<double>(random() >> 8) * (1.0 / 16777216.0);
+    }
+
+    // uniform in [0, range) by scaling a 32-bit draw, the bias is below range / 2^32
+    int PickBelow(std::mt19937& random, std::uint32_t range)
+    {
+        return static_cast<int>((static_cast<std::uint64_t>(random()) * range) >> 32);
+    }
+
+    // picks atlas indices following one of the distributions
+    class TilePicker {
+    public:
+        TilePicker(const MapGenerator::Settings& settings)
+            : distribution(settings.distribution),
+            tileCount(static_cast<std::uint32_t>(std::max(settings.tileCount, 1)))
+        {
+            // zipf weights in fixed point, so the picks don't depend on the last bit
+            // of std::pow, stored as running totals for a binary search
+            cumulativeWeights.resize(tileCount);
+            std::uint64_t total = 0;
+            for (std::uint32_t i = 0; i < tileCount; ++i) {
+                double weight = 1048576.0 / std::pow(i + 1.0, settings.zipfExponent);
+                total += std::max<std::uint64_t>(std::llround(weight), 1);
+                cumulativeWeights[i] = total;
+            }
+        }
+
+        int Pick(std::mt19937& random)
+        {
+            if (distribution == MapGenerator::TileDistribution::Uniform) {
+                return PickBelow(random, tileCount);
+            }
+            // 64 random bits reduced to the weight total, the totals stay far below
+            // 2^64 so the modulo bias is negligible. two statements, the order of
+            // the draws inside one expression would be up to the compiler
+            std::uint64_t bits = static_cast<std::uint64_t>(random()) << 32;
+            bits |= random();
+            std::uint64_t target = bits % cumulativeWeights.back();
+            return static_cast<int>(std::upper_bound(cumulativeWeights.begin(),
+                cumulativeWeights.end(), target) - cumulativeWeights.begin());
+        }
+
+    private:
+        MapGenerator::TileDistribution distribution;
+        std::uint32_t tileCount;
+        std::vector<std::uint64_t> cumulativeWeights;
+    };
+}
+
+void MapGenerator::Generate(MapModel& map, const Settings& settings)
+{
+    std::mt19937 random(settings.seed);
+    TilePicker picker(settings);
+    const bool isClustered = settings.distribution == TileDistribution::Clustered;
+    const int clusterSize = std::max(settings.clusterSize, 1);
+    // clustered maps keep one base tile per block, 1 in 8 cells gets a detail tile
+    const double detailChance = 0.125;
+
+    std::vector<TileCell::Id> row(std::max(settings.width, 0));
+    std::vector<int> blockTiles;
+    for (int i = 0; i < settings.layerCount; ++i) {
+        int index = map.AddLayer(settings.width, settings.height);
+        MapModel::Layer& layer = map.GetLayers()[index];
+        for (int y = 0; y < settings.height; ++y) {
+            if (isClustered && y % clusterSize == 0) {
+                blockTiles.resize((settings.width + clusterSize - 1) / clusterSize);
+                for (int& tile : blockTiles) tile = picker.Pick(random);
+            }
+            for (int x = 0; x < settings.width; ++x) {
+                TileCell::Id cell = TileCell::Empty;
+                if (Chance(random) < settings.density) {
+                    int tile = isClustered && Chance(random) >= detailChance
+                        ? blockTiles[x / clusterSize] : picker.Pick(random);
+                    cell = TileCell::Make(tile);
+                }
+                row[x] = cell;
+                if (Chance(random) < settings.collisionDensity) {
+                    layer.collisionGrid.Set(x, y, true);
+                }
+            }
+            // whole rows go through the chunk spans instead of cell by cell
+            if (settings.width > 0) layer.layer.WriteRow(0, y, settings.width, row.data());
+        }
+    }
+}
+
+bool MapGenerator::ParseDistribution(const std::string& name, TileDistribution& distribution)
+{
+    if (name == "uniform") distribution = TileDistribution::Uniform;
+    else if (name == "zipf") distribution = TileDistribution::Zipf;
+    else if (name == "clustered") distribution = TileDistribution::Clustered;
+    else return false;
+    return true;
+}
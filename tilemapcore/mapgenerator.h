@@ -0,0 +1,39 @@
+#ifndef MAPGENERATOR_H
+#define MAPGENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include "mapmodel.h"
+
+/*  synthetic maps for load tests and benchmarks: the same settings and seed always
+    produce the same cells, so results can be compared between builds and machines
+    without shipping real maps. the generated layers are written straight into the
+    grids, nothing ends up in the undo history
+*/
+namespace MapGenerator {
+    enum class TileDistribution {
+        Uniform,    // every atlas index equally likely
+        Zipf,       // a few tiles dominate like ground/wall tiles in real maps
+        Clustered   // blocks of one tile with scattered detail, compresses like real maps
+    };
+
+    struct Settings {
+        int width = 256;
+        int height = 256;
+        int layerCount = 1;
+        double density = 0.6;           // share of cells that hold a tile
+        double collisionDensity = 0.1;  // share of cells with collision
+        int tileCount = 256;            // atlas indices [0, tileCount) are used
+        TileDistribution distribution = TileDistribution::Uniform;
+        double zipfExponent = 1.1;      // skew of the zipf and clustered distributions
+        int clusterSize = 8;            // side of a clustered block in cells
+        std::uint32_t seed = 12345;
+    };
+
+    // appends settings.layerCount generated layers to the map
+    void Generate(MapModel& map, const Settings& settings);
+    // parses "uniform", "zipf" or "clustered", returns false for anything else
+    bool ParseDistribution(const std::string& name, TileDistribution& distribution);
+}
+
+#endif // !MAPGENERATOR_H
@@ -0,0 +1,278 @@
+#include "mapmodel.h"
+#include <algorithm>
+#include "floodfill.h"
+#include "collisionmesh.h"
+#include "tilemapserializer.h"
+#include "tilemapbinaryserializer.h"
+
+void MapModel::SetAtlasLayout(int atlasColumns, int tileSize)
+{
+    this->atlasColumns = std::max(atlasColumns, 1);
+    this->tileSize = std::max(tileSize, 1);
+}
+
+// -------------------------------- LAYER FUNCTIONS --------------------------------
+
+int MapModel::AddLayer(int width, int height)
+{
+    Layer newLayer;
+    newLayer.width = width;
+    newLayer.height = height;
+    newLayer.isVisible = true;
+    newLayer.opacity = 1.0f;
+    newLayer.index = static_cast<int>(layers.size());
+    // chunks are allocated lazily on the first write, so this doesn't touch the cells
+    newLayer.layer = ChunkedGrid(width, height);
+    newLayer.collisionGrid = BitGrid(width, height);
+    layers.push_back(std::move(newLayer));
+    ++modifyCount;
+    return static_cast<int>(layers.size()) - 1;
+}
+
+bool MapModel::IsInside(int layerIndex, int x, int y) const
+{
+    if (layerIndex < 0 || layerIndex >= static_cast<int>(layers.size())) return false;
+    const Layer& layer = layers[layerIndex];
+    return x >= 0 && x < layer.width && y >= 0 && y < layer.height;
+}
+
+// -------------------------------- EDIT FUNCTIONS --------------------------------
+
+void MapModel::SetCell(int layerIndex, int x, int y, TileCell::Id tile)
+{
+    Layer& layer = layers[layerIndex];
+    TileCell::Id before = layer.Get(x, y);
+    if (before == tile) return;
+    layer.Set(x, y, tile);
+    undoStack.RecordTile(layerIndex, x, y, before, tile);
+}
+
+void MapModel::SetCollision(int layerIndex, int x, int y, bool value)
+{
+    BitGrid& collisionGrid = layers[layerIndex].collisionGrid;
+    bool before = collisionGrid.Get(x, y);
+    if (before == value) return;
+    collisionGrid.Set(x, y, value);
+    undoStack.RecordCollision(layerIndex, x, y, before, value);
+    ++modifyCount;
+}
+
+void MapModel::SetRow(int layerIndex, int x, int y, int count, const TileCell::Id* cells)
+{
+    Layer& layer = layers[layerIndex];
+    std::vector<TileCell::Id> before(count);
+    layer.layer.ReadRow(x, y, count, before.data());
+    layer.layer.WriteRow(x, y, count, cells);
+    undoStack.RecordTileRow(layerIndex, x, y, count, before.data(), cells, true);
+}
+
+void MapModel::SetCollisionRow(int layerIndex, int y, int startX, int endX, bool value)
+{
+    BitGrid& collisionGrid = layers[layerIndex].collisionGrid;
+    // record every run of cells that actually flips
+    int runStart = -1;
+    for (int x = startX; x <= endX; ++x) {
+        bool flips = x < endX && collisionGrid.Get(x, y) != value;
+        if (flips && runStart < 0) runStart = x;
+        else if (!flips && runStart >= 0) {
+            undoStack.RecordCollisionRow(layerIndex, runStart, y, x - runStart, !value, value);
+            runStart = -1;
+        }
+    }
+    collisionGrid.FillRow(y, startX, endX, value);
+    ++modifyCount;
+}
+
+void MapModel::PlaceStamp(const Stamp& stamp, int layerIndex, int x, int y)
+{
+    if (layerIndex < 0 || layerIndex >= static_cast<int>(layers.size())) return;
+    Layer& layer = layers[layerIndex];
+
+    // clip the stamp rectangle against the layer once
+    int left = x - stamp.originX;
+    int top = y - stamp.originY;
+    int startX = std::max(left, 0);
+    int startY = std::max(top, 0);
+    int endX = std::min(left + stamp.width, layer.width);
+    int endY = std::min(top + stamp.height, layer.height);
+    if (startX >= endX || startY >= endY) return;
+
+    int count = endX - startX;
+    std::vector<TileCell::Id> before(count);
+    std::vector<TileCell::Id> after(count);
+    for (int targetY = startY; targetY < endY; ++targetY) {
+        const TileCell::Id* stampRow = stamp.cells.data()
+            + static_cast<size_t>(targetY - top) * stamp.width + (startX - left);
+        layer.layer.ReadRow(startX, targetY, count, before.data());
+        const TileCell::Id* cells = stampRow;
+        if (stamp.hasHoles) {
+            // holes keep the tiles that are already there
+            for (int i = 0; i < count; ++i) {
+                after[i] = TileCell::IsEmpty(stampRow[i]) ? before[i] : stampRow[i];
+            }
+            cells = after.data();
+        }
+        // whole rows are copied chunk span by chunk span and recorded as one row diff,
+        // cells stamped again later in the stroke just get another diff
+        layer.layer.WriteRow(startX, targetY, count, cells);
+        undoStack.RecordTileRow(layerIndex, startX, targetY, count, before.data(), cells,
+            true);
+    }
+}
+
+void MapModel::FillTiles(int layerIndex, int seedX, int seedY, const Stamp& pattern,
+    bool erase)
+{
+    if (!IsInside(layerIndex, seedX, seedY)) return;
+    Layer& layer = layers[layerIndex];
+    TileCell::Id target = layer.Get(seedX, seedY);
+
+    // a single tile is a 1x1 pattern, cells the pattern doesn't cover keep their tile
+    int patternWidth = erase ? 1 : pattern.width;
+    int patternHeight = erase ? 1 : pattern.height;
+    if (patternWidth <= 0 || patternHeight <= 0) return;
+    std::vector<TileCell::Id> cells(static_cast<size_t>(patternWidth) * patternHeight,
+        TileCell::Empty);
+    if (!erase) {
+        for (size_t i = 0; i < cells.size(); ++i) {
+            cells[i] = TileCell::IsEmpty(pattern.cells[i]) ? target : pattern.cells[i];
+        }
+    }
+    // nothing would change, e.g. filling a region with the tile it already has
+    if (std::all_of(cells.begin(), cells.end(),
+        [target](TileCell::Id tile) { return tile == target; })) return;
+
+    std::vector<FloodFill::Span> spans = FloodFill::FindRegion(layer.width, layer.height,
+        seedX, seedY, [&layer, target](int x, int y) { return layer.Get(x, y) == target; });
+
+    // the pattern is anchored so its origin lands on the seed cell
+    int originX = erase ? 0 : pattern.originX;
+    int originY = erase ? 0 : pattern.originY;
+    std::vector<TileCell::Id> row;
+    for (const auto& span : spans) {
+        row.resize(span.endX - span.startX);
+        int patternY = ((span.y - seedY + originY) % patternHeight + patternHeight)
+            % patternHeight;
+        const TileCell::Id* patternRow = cells.data()
+            + static_cast<size_t>(patternY) * patternWidth;
+        for (int x = span.startX; x < span.endX; ++x) {
+            int patternX = ((x - seedX + originX) % patternWidth + patternWidth)
+                % patternWidth;
+            row[x - span.startX] = patternRow[patternX];
+        }
+        SetRow(layerIndex, span.startX, span.y, span.endX - span.startX, row.data());
+    }
+}
+
+void MapModel::FillCollision(int layerIndex, int seedX, int seedY, bool value)
+{
+    if (!IsInside(layerIndex, seedX, seedY)) return;
+    Layer& layer = layers[layerIndex];
+    const BitGrid& collisionGrid = layer.collisionGrid;
+    bool target = collisionGrid.Get(seedX, seedY);
+    if (target == value) return;
+
+    std::vector<FloodFill::Span> spans = FloodFill::FindRegion(layer.width, layer.height,
+        seedX, seedY, [&collisionGrid, target](int x, int y) {
+            return collisionGrid.Get(x, y) == target;
+        });
+    // every cell of a span flips, so each span is a single word-level fill
+    for (const auto& span : spans) {
+        SetCollisionRow(layerIndex, span.y, span.startX, span.endX, value);
+    }
+}
+
+// -------------------------------- UNDO / REDO FUNCTIONS --------------------------------
+
+void MapModel::ApplyUndoEntry(const UndoStack::Entry& entry, bool useBefore)
+{
+    // row diffs aren't coalesced per cell, so a cell can appear more than once in an
+    // entry. undo walks the diffs backwards so the oldest before value is written last
+    auto applyTile = [this, useBefore](const UndoStack::TileDiff& diff) {
+        if (diff.layer < 0 || diff.layer >= static_cast<int>(layers.size())) return;
+        layers[diff.layer].Set(diff.x, diff.y, useBefore ? diff.before : diff.after);
+    };
+    auto applyCollision = [this, useBefore](const UndoStack::CollisionDiff& diff) {
+        if (diff.layer < 0 || diff.layer >= static_cast<int>(layers.size())) return;
+        layers[diff.layer].collisionGrid.FillRow(diff.y, diff.x, diff.x + diff.count,
+            useBefore ? diff.before : diff.after);
+    };
+    if (useBefore) {
+        std::for_each(entry.tiles.rbegin(), entry.tiles.rend(), applyTile);
+        std::for_each(entry.collisions.rbegin(), entry.collisions.rend(), applyCollision);
+    }
+    else {
+        std::for_each(entry.tiles.begin(), entry.tiles.end(), applyTile);
+        std::for_each(entry.collisions.begin(), entry.collisions.end(), applyCollision);
+    }
+    if (!entry.collisions.empty()) ++modifyCount;
+}
+
+bool MapModel::Undo()
+{
+    const UndoStack::Entry* entry = undoStack.Undo();
+    if (entry) ApplyUndoEntry(*entry, true);
+    return entry != nullptr;
+}
+
+bool MapModel::Redo()
+{
+    const UndoStack::Entry* entry = undoStack.Redo();
+    if (entry) ApplyUndoEntry(*entry, false);
+    return entry != nullptr;
+}
+
+// -------------------------------- EXPORT FUNCTIONS --------------------------------
+
+bool MapModel::ExportCollisionJson(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file for export: " << filename << "\n";
+        return false;
+    }
+
+    // whole layers are meshed at once, so rectangles aren't split at chunk borders.
+    // compact, a mostly solid map can still have a lot of rectangles
+    JsonWriter writer(file);
+    writer.BeginObject();
+    writer.Key("tileSize");
+    writer.Int(tileSize);
+    writer.Key("layers");
+    writer.BeginArray();
+    std::vector<CollisionMesh::Rect> rects;
+    for (const auto& layer : layers) {
+        rects.clear();
+        CollisionMesh::Build(layer.collisionGrid, 0, 0, layer.width, layer.height, rects);
+        writer.BeginObject();
+        writer.Key("index");
+        writer.Int(layer.index);
+        writer.Key("width");
+        writer.Int(layer.width);
+        writer.Key("height");
+        writer.Int(layer.height);
+        // [x, y, width, height] in cells, multiply by tileSize for pixels
+        writer.Key("rects");
+        writer.BeginArray();
+        for (const auto& rect : rects) {
+            writer.BeginArray();
+            writer.Int(rect.x);
+            writer.Int(rect.y);
+            writer.Int(rect.width);
+            writer.Int(rect.height);
+            writer.EndArray();
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+    file << "\n";
+
+    file.close();
+    if (file.fail()) {
+        std::cerr << "Failed to write collision: " << filename << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,126 @@
+#ifndef MAPMODEL_H
+#define MAPMODEL_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "tilecell.h"
+#include "chunkedgrid.h"
+#include "bitgrid.h"
+#include "undostack.h"
+
+/*  the map without a window or any rendering: the layers (packed cells and collision
+    bits), every editing operation, the undo/redo history and loading/saving. the
+    editor's TileMap turns mouse input into these calls and draws the result, tools and
+    benchmarks can use it directly on machines without a display.
+    cell coordinates and layer indices passed to the editing functions are expected to
+    be valid unless a function says otherwise
+*/
+class MapModel {
+public:
+    struct Layer {
+        int width;              // controls the width and height of the layer
+        int height;
+        bool isVisible;         // used to hide inactive layers
+        float opacity = 0.5f;   // used to change visiblity of active layer when merged
+        int index;              // index to access specific layer in whole game map
+
+        // chunked grid of packed cells makes up an entire layer, chunks are
+        // only allocated for areas that have been painted
+        ChunkedGrid layer;
+        // bit-packed collision grid for a specific layer
+        BitGrid collisionGrid;
+
+        TileCell::Id Get(int x, int y) const { return layer.Get(x, y); }
+        void Set(int x, int y, TileCell::Id tile) { layer.Set(x, y, tile); }
+    };
+
+    // precomputed block of packed cells for PlaceStamp, empty cells are holes that keep
+    // whatever is already on the layer
+    struct Stamp {
+        int width = 0;
+        int height = 0;
+        int originX = 0;                    // stamp cell that lands on the target cell
+        int originY = 0;
+        std::vector<TileCell::Id> cells;    // row-major, width * height
+        bool hasHoles = false;
+    };
+
+    // the atlas layout, the json format stores texture rects derived from it
+    void SetAtlasLayout(int atlasColumns, int tileSize);
+    int GetAtlasColumns() const { return atlasColumns; }
+    int GetTileSize() const { return tileSize; }
+
+    // layers
+    int AddLayer(int width, int height);    // returns the new layer's index
+    std::vector<Layer>& GetLayers() { return layers; }
+    const std::vector<Layer>& GetLayers() const { return layers; }
+    bool IsInside(int layerIndex, int x, int y) const;
+
+    // single cell edits, recorded in the undo history
+    void SetCell(int layerIndex, int x, int y, TileCell::Id tile);
+    void SetCollision(int layerIndex, int x, int y, bool value);
+    // places a stamp with its origin on cell (x, y), clipped to the layer and written row
+    // by row as one edit
+    void PlaceStamp(const Stamp& stamp, int layerIndex, int x, int y);
+    // bucket fill of the 4-connected region around a cell, tiles repeat the pattern
+    // anchored with its origin at the seed cell (pattern holes keep their tile), or
+    // clear the region when erase is set. out of range seeds are ignored
+    void FillTiles(int layerIndex, int seedX, int seedY, const Stamp& pattern, bool erase);
+    void FillCollision(int layerIndex, int seedX, int seedY, bool value);
+
+    // edit history, everything between BeginEdit and EndEdit is one undo step
+    void BeginEdit() { undoStack.BeginStroke(); }
+    void EndEdit() { undoStack.EndStroke(); }
+    bool Undo();
+    bool Redo();
+    UndoStack& GetUndoStack() { return undoStack; }
+
+    // save/load pick the json or binary (.tmb) format from the file extension
+    bool SaveTileMap(const std::string& filename) const;
+    bool LoadTileMap(const std::string& filename);
+    // compact drops the indentation, the default matches the old pretty-printed files
+    bool SaveTileMapJson(const std::string& filename, bool compact = false) const;
+    bool LoadTileMapJson(const std::string& filename);
+    bool SaveTileMapBinary(const std::string& filename) const;
+    bool LoadTileMapBinary(const std::string& filename);
+    // snapshots the map and returns a job that writes it to filename (through a
+    // temporary file that replaces the target once complete), for the AutoSaver
+    std::function<bool()> MakeSaveJob(const std::string& filename) const;
+    // writes the collision of every layer as greedy-meshed rectangles (see
+    // CollisionMesh) in cells, for game physics. returns false on failure
+    bool ExportCollisionJson(const std::string& filename) const;
+    // changes whenever the map content changes, used to skip redundant autosaves
+    std::uint64_t GetContentRevision() const;
+
+private:
+    // copy of everything a save needs, cheap to take because chunks are shared
+    // copy-on-write, and safe to write out on another thread while editing goes on
+    struct MapSnapshot {
+        std::vector<Layer> layers;
+        int atlasColumns = 1;       // to derive texture rects from atlas indices
+        int tileSize = 16;          // unscaled tile size
+    };
+    MapSnapshot TakeSnapshot() const;
+    static bool WriteTileMapJson(const MapSnapshot& map, const std::string& filename,
+        bool compact);
+    static bool WriteTileMapBinary(const MapSnapshot& map, const std::string& filename);
+    static bool IsBinaryFile(const std::string& filename);
+
+    // bulk versions for region edits, recorded as row diffs without per-cell
+    // coalescing (see UndoStack::RecordTileRow)
+    void SetRow(int layerIndex, int x, int y, int count, const TileCell::Id* cells);
+    void SetCollisionRow(int layerIndex, int y, int startX, int endX, bool value);
+    // writes the before (undo) or after (redo) side of an entry without recording it
+    void ApplyUndoEntry(const UndoStack::Entry& entry, bool useBefore);
+
+    std::vector<Layer> layers;
+    int atlasColumns = 1;
+    int tileSize = 16;
+    // bumped by edits that the layer grid revisions don't cover (collision, layers)
+    std::uint64_t modifyCount = 0;
+    UndoStack undoStack;
+};
+
+#endif // !MAPMODEL_H
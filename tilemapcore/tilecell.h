@@ -0,0 +1,38 @@
+#ifndef TILECELL_H
+#define TILECELL_H
+
+#include <cstdint>
+
+/*  packed layout of a single grid cell (32 bits):
+    bits 0-28  = atlas index + 1, so a zeroed cell means "no tile"
+    bit 29     = diagonal flip (swap x/y, combined with the other flips gives rotation)
+    bit 30     = vertical flip
+    bit 31     = horizontal flip
+    sprites, texture rects and positions are derived from this only at render time
+*/
+namespace TileCell {
+    using Id = std::uint32_t;
+
+    constexpr Id Empty = 0;
+    constexpr Id FlipHorizontal = 0x80000000u;
+    constexpr Id FlipVertical = 0x40000000u;
+    constexpr Id FlipDiagonal = 0x20000000u;
+    constexpr Id FlagMask = FlipHorizontal | FlipVertical | FlipDiagonal;
+    constexpr Id IndexMask = ~FlagMask;
+
+    // builds a packed cell from an atlas index and optional flip flags
+    inline Id Make(int atlasIndex, Id flags = 0)
+    {
+        if (atlasIndex < 0) return Empty;
+        return ((static_cast<Id>(atlasIndex) + 1) & IndexMask) | (flags & FlagMask);
+    }
+
+    inline bool IsEmpty(Id cell) { return (cell & IndexMask) == 0; }
+
+    // returns the atlas index of the cell, or -1 when the cell is empty
+    inline int GetIndex(Id cell) { return static_cast<int>(cell & IndexMask) - 1; }
+
+    inline Id GetFlags(Id cell) { return cell & FlagMask; }
+}
+
+#endif // !TILECELL_H
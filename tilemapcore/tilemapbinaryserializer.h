@@ -0,0 +1,374 @@
+#ifndef TILEMAPBINARYSERIALIZER_H
+#define TILEMAPBINARYSERIALIZER_H
+
+#include "mapmodel.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+/*  versioned binary map format (.tmb), every value is little-endian:
+    header (16 bytes):
+        char[4] magic = "TMAP", u16 version, u16 flags (0), u32 layerCount, u32 tileSize
+    layer table (layerCount entries, 48 bytes each):
+        i32 width, i32 height, u8 isVisible, u8 cellEncoding, u16 reserved, f32 opacity,
+        u64 cellOffset, u64 cellSize, u64 collisionOffset, u64 collisionSize
+    cell data (per layer, at cellOffset):
+        encoding 0 = raw, width * height packed u32 cells in row-major order
+        encoding 1 = rle, (u32 runLength, u32 cell) pairs covering all cells in row-major order
+    collision data (per layer, at collisionOffset):
+        height * ceil(width / 64) u64 words, bit x % 64 of word x / 64 is cell x of the row
+    offsets are absolute file positions, whichever cell encoding is smaller gets written.
+    loading checks every size and offset against the file length and the limits below
+    before allocating, so a corrupt file is rejected instead of exhausting memory
+*/
+namespace BinaryMapFormat {
+    constexpr char Magic[4] = { 'T', 'M', 'A', 'P' };
+    constexpr std::uint16_t Version = 1;
+    constexpr size_t HeaderSize = 16;
+    constexpr size_t LayerEntrySize = 48;
+    constexpr std::uint8_t RawCells = 0;
+    constexpr std::uint8_t RleCells = 1;
+    constexpr std::int32_t MaxLayerSide = 1 << 16;      // cells per layer side
+    constexpr std::uint64_t MaxLayerCells = 1ull << 28; // cells per layer
+    constexpr std::uint32_t MaxTileSize = 1024;         // pixels
+
+    // true when [offset, offset + size) lies inside a file of fileSize bytes
+    inline bool IsInFile(std::uint64_t offset, std::uint64_t size, std::uint64_t fileSize)
+    {
+        return offset <= fileSize && size <= fileSize - offset;
+    }
+
+    struct LayerEntry {
+        std::int32_t width = 0;
+        std::int32_t height = 0;
+        std::uint8_t isVisible = 1;
+        std::uint8_t cellEncoding = RawCells;
+        float opacity = 1.0f;
+        std::uint64_t cellOffset = 0;
+        std::uint64_t cellSize = 0;
+        std::uint64_t collisionOffset = 0;
+        std::uint64_t collisionSize = 0;
+    };
+
+    // little-endian encoding independent of the host byte order
+    inline void Put(std::vector<char>& buffer, std::uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i) {
+            buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+    inline std::uint64_t Get(const char* data, int bytes)
+    {
+        std::uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+        }
+        return value;
+    }
+    inline std::uint32_t FloatBits(float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+    inline float BitsToFloat(std::uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    inline void PutLayerEntry(std::vector<char>& buffer, const LayerEntry& entry)
+    {
+        Put(buffer, static_cast<std::uint32_t>(entry.width), 4);
+        Put(buffer, static_cast<std::uint32_t>(entry.height), 4);
+        Put(buffer, entry.isVisible, 1);
+        Put(buffer, entry.cellEncoding, 1);
+        Put(buffer, 0, 2);
+        Put(buffer, FloatBits(entry.opacity), 4);
+        Put(buffer, entry.cellOffset, 8);
+        Put(buffer, entry.cellSize, 8);
+        Put(buffer, entry.collisionOffset, 8);
+        Put(buffer, entry.collisionSize, 8);
+    }
+    inline LayerEntry GetLayerEntry(const char* data)
+    {
+        LayerEntry entry;
+        entry.width = static_cast<std::int32_t>(Get(data, 4));
+        entry.height = static_cast<std::int32_t>(Get(data + 4, 4));
+        entry.isVisible = static_cast<std::uint8_t>(Get(data + 8, 1));
+        entry.cellEncoding = static_cast<std::uint8_t>(Get(data + 9, 1));
+        entry.opacity = BitsToFloat(static_cast<std::uint32_t>(Get(data + 12, 4)));
+        entry.cellOffset = Get(data + 16, 8);
+        entry.cellSize = Get(data + 24, 8);
+        entry.collisionOffset = Get(data + 32, 8);
+        entry.collisionSize = Get(data + 40, 8);
+        return entry;
+    }
+}
+
+bool MapModel::SaveTileMapBinary(const std::string& filename) const
+{
+    return WriteTileMapBinary(TakeSnapshot(), filename);
+}
+
+bool MapModel::WriteTileMapBinary(const MapSnapshot& map, const std::string& filename)
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file for saving: " << filename << "\n";
+        return false;
+    }
+
+    // header and a placeholder layer table, the table is patched once the offsets are known
+    std::vector<char> buffer;
+    buffer.insert(buffer.end(), BinaryMapFormat::Magic, BinaryMapFormat::Magic + 4);
+    BinaryMapFormat::Put(buffer, BinaryMapFormat::Version, 2);
+    BinaryMapFormat::Put(buffer, 0, 2);
+    BinaryMapFormat::Put(buffer, map.layers.size(), 4);
+    BinaryMapFormat::Put(buffer, static_cast<std::uint32_t>(map.tileSize), 4);
+    buffer.resize(buffer.size() + map.layers.size() * BinaryMapFormat::LayerEntrySize, 0);
+    file.write(buffer.data(), buffer.size());
+
+    std::vector<BinaryMapFormat::LayerEntry> entries;
+    std::vector<TileCell::Id> row;
+    for (const auto& layer : map.layers) {
+        BinaryMapFormat::LayerEntry entry;
+        entry.width = layer.width;
+        entry.height = layer.height;
+        entry.isVisible = layer.isVisible ? 1 : 0;
+        entry.opacity = layer.opacity;
+        row.resize(layer.width);
+
+        // count the runs first so the smaller of the two encodings can be picked
+        std::uint64_t runs = 0;
+        TileCell::Id previous = 0;
+        for (int y = 0; y < layer.height; ++y) {
+            layer.layer.ReadRow(0, y, layer.width, row.data());
+            for (int x = 0; x < layer.width; ++x) {
+                if ((x == 0 && y == 0) || row[x] != previous) ++runs;
+                previous = row[x];
+            }
+        }
+        std::uint64_t cellCount = static_cast<std::uint64_t>(layer.width) * layer.height;
+        entry.cellEncoding = runs * 8 < cellCount * 4 ? BinaryMapFormat::RleCells
+            : BinaryMapFormat::RawCells;
+
+        // stream the cells one row at a time
+        entry.cellOffset = static_cast<std::uint64_t>(file.tellp());
+        std::uint32_t runLength = 0;
+        for (int y = 0; y < layer.height; ++y) {
+            buffer.clear();
+            layer.layer.ReadRow(0, y, layer.width, row.data());
+            for (int x = 0; x < layer.width; ++x) {
+                if (entry.cellEncoding == BinaryMapFormat::RawCells) {
+                    BinaryMapFormat::Put(buffer, row[x], 4);
+                }
+                else if (runLength > 0 && row[x] == previous && runLength < UINT32_MAX) {
+                    ++runLength;
+                }
+                else {
+                    if (runLength > 0) {
+                        BinaryMapFormat::Put(buffer, runLength, 4);
+                        BinaryMapFormat::Put(buffer, previous, 4);
+                    }
+                    previous = row[x];
+                    runLength = 1;
+                }
+            }
+            file.write(buffer.data(), buffer.size());
+        }
+        if (runLength > 0) {
+            buffer.clear();
+            BinaryMapFormat::Put(buffer, runLength, 4);
+            BinaryMapFormat::Put(buffer, previous, 4);
+            file.write(buffer.data(), buffer.size());
+        }
+        entry.cellSize = static_cast<std::uint64_t>(file.tellp()) - entry.cellOffset;
+
+        // collision rows are written as they are stored, one bit per cell
+        entry.collisionOffset = static_cast<std::uint64_t>(file.tellp());
+        for (int y = 0; y < layer.height; ++y) {
+            buffer.clear();
+            const BitGrid::Word* words = layer.collisionGrid.GetRow(y);
+            for (int w = 0; w < layer.collisionGrid.GetWordsPerRow(); ++w) {
+                BinaryMapFormat::Put(buffer, words[w], 8);
+            }
+            file.write(buffer.data(), buffer.size());
+        }
+        entry.collisionSize = static_cast<std::uint64_t>(file.tellp()) - entry.collisionOffset;
+        entries.push_back(entry);
+    }
+
+    // go back and fill in the layer table
+    buffer.clear();
+    for (const auto& entry : entries) BinaryMapFormat::PutLayerEntry(buffer, entry);
+    file.seekp(BinaryMapFormat::HeaderSize);
+    file.write(buffer.data(), buffer.size());
+    if (!file) {
+        std::cerr << "Failed to write tile map: " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool MapModel::LoadTileMapBinary(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file for loading: " << filename << "\n";
+        return false;
+    }
+    std::uint64_t fileSize = static_cast<std::uint64_t>(file.tellg());
+    file.seekg(0);
+
+    char header[BinaryMapFormat::HeaderSize];
+    if (!file.read(header, sizeof(header)) || std::memcmp(header, BinaryMapFormat::Magic, 4) != 0) {
+        std::cerr << "Not a binary tile map: " << filename << "\n";
+        return false;
+    }
+    std::uint16_t version = static_cast<std::uint16_t>(BinaryMapFormat::Get(header + 4, 2));
+    if (version > BinaryMapFormat::Version) {
+        std::cerr << "Unsupported tile map version " << version << ": " << filename << "\n";
+        return false;
+    }
+    std::uint32_t layerCount = static_cast<std::uint32_t>(BinaryMapFormat::Get(header + 8, 4));
+    std::uint32_t fileTileSize = static_cast<std::uint32_t>(BinaryMapFormat::Get(header + 12, 4));
+    if (fileTileSize == 0 || fileTileSize > BinaryMapFormat::MaxTileSize) {
+        std::cerr << "Invalid tile size in: " << filename << "\n";
+        return false;
+    }
+    if (!BinaryMapFormat::IsInFile(BinaryMapFormat::HeaderSize,
+        static_cast<std::uint64_t>(layerCount) * BinaryMapFormat::LayerEntrySize, fileSize))
+    {
+        std::cerr << "Truncated layer table: " << filename << "\n";
+        return false;
+    }
+
+    std::vector<char> buffer(static_cast<size_t>(layerCount) * BinaryMapFormat::LayerEntrySize);
+    if (!file.read(buffer.data(), buffer.size())) {
+        std::cerr << "Truncated layer table: " << filename << "\n";
+        return false;
+    }
+
+    // load into a separate vector so a broken file leaves the current map untouched
+    std::vector<Layer> loadedLayers;
+    std::vector<TileCell::Id> row;
+    for (std::uint32_t i = 0; i < layerCount; ++i) {
+        BinaryMapFormat::LayerEntry entry = BinaryMapFormat::GetLayerEntry(
+            buffer.data() + i * BinaryMapFormat::LayerEntrySize);
+        if (entry.width < 0 || entry.height < 0 || entry.width > BinaryMapFormat::MaxLayerSide
+            || entry.height > BinaryMapFormat::MaxLayerSide
+            || static_cast<std::uint64_t>(entry.width) * entry.height
+            > BinaryMapFormat::MaxLayerCells)
+        {
+            std::cerr << "Invalid layer size in: " << filename << "\n";
+            return false;
+        }
+        // both sections have to be inside the file before anything is allocated for them
+        if (!BinaryMapFormat::IsInFile(entry.cellOffset, entry.cellSize, fileSize)
+            || !BinaryMapFormat::IsInFile(entry.collisionOffset, entry.collisionSize, fileSize))
+        {
+            std::cerr << "Layer data outside the file in: " << filename << "\n";
+            return false;
+        }
+        Layer newLayer;
+        newLayer.width = entry.width;
+        newLayer.height = entry.height;
+        newLayer.isVisible = entry.isVisible != 0;
+        newLayer.opacity = entry.opacity;
+        newLayer.index = static_cast<int>(i);
+        newLayer.layer = ChunkedGrid(newLayer.width, newLayer.height);
+        newLayer.collisionGrid = BitGrid(newLayer.width, newLayer.height);
+
+        std::uint64_t cellCount = static_cast<std::uint64_t>(entry.width) * entry.height;
+        std::vector<char> data;
+        row.resize(newLayer.width);
+        file.seekg(entry.cellOffset);
+        if (entry.cellEncoding == BinaryMapFormat::RawCells) {
+            if (entry.cellSize != cellCount * 4) {
+                std::cerr << "Invalid cell data size in: " << filename << "\n";
+                return false;
+            }
+            // raw cells are read one row at a time
+            data.resize(static_cast<size_t>(newLayer.width) * 4);
+            for (int y = 0; y < newLayer.height; ++y) {
+                if (!file.read(data.data(), data.size())) {
+                    std::cerr << "Truncated cell data in: " << filename << "\n";
+                    return false;
+                }
+                for (int x = 0; x < newLayer.width; ++x) {
+                    row[x] = static_cast<TileCell::Id>(BinaryMapFormat::Get(data.data() + x * 4, 4));
+                }
+                newLayer.layer.WriteRow(0, y, newLayer.width, row.data());
+            }
+        }
+        else if (entry.cellEncoding == BinaryMapFormat::RleCells) {
+            data.resize(static_cast<size_t>(entry.cellSize));
+            if (!file.read(data.data(), data.size())) {
+                std::cerr << "Truncated cell data in: " << filename << "\n";
+                return false;
+            }
+            // expand the runs row by row, a run may continue over several rows
+            size_t position = 0;
+            std::uint32_t runLength = 0;
+            TileCell::Id cell = TileCell::Empty;
+            for (int y = 0; y < newLayer.height; ++y) {
+                for (int x = 0; x < newLayer.width; ++x) {
+                    if (runLength == 0) {
+                        if (position + 8 > data.size()) {
+                            std::cerr << "Truncated run data in: " << filename << "\n";
+                            return false;
+                        }
+                        runLength = static_cast<std::uint32_t>(
+                            BinaryMapFormat::Get(data.data() + position, 4));
+                        cell = static_cast<TileCell::Id>(
+                            BinaryMapFormat::Get(data.data() + position + 4, 4));
+                        position += 8;
+                        if (runLength == 0) {
+                            std::cerr << "Invalid run length in: " << filename << "\n";
+                            return false;
+                        }
+                    }
+                    row[x] = cell;
+                    --runLength;
+                }
+                newLayer.layer.WriteRow(0, y, newLayer.width, row.data());
+            }
+        }
+        else {
+            std::cerr << "Unknown cell encoding in: " << filename << "\n";
+            return false;
+        }
+
+        int wordsPerRow = newLayer.collisionGrid.GetWordsPerRow();
+        if (entry.collisionSize != static_cast<std::uint64_t>(wordsPerRow) * newLayer.height * 8) {
+            std::cerr << "Invalid collision data size in: " << filename << "\n";
+            return false;
+        }
+        data.resize(static_cast<size_t>(wordsPerRow) * 8);
+        file.seekg(entry.collisionOffset);
+        for (int y = 0; y < newLayer.height; ++y) {
+            if (!file.read(data.data(), data.size())) {
+                std::cerr << "Truncated collision data in: " << filename << "\n";
+                return false;
+            }
+            BitGrid::Word* words = newLayer.collisionGrid.GetRow(y);
+            for (int w = 0; w < wordsPerRow; ++w) {
+                words[w] = BinaryMapFormat::Get(data.data() + w * 8, 8);
+            }
+            // keep the padding bits past the row end cleared
+            if (newLayer.width % BitGrid::WordBits != 0) {
+                words[wordsPerRow - 1] &= (BitGrid::Word(1)
+                    << (newLayer.width % BitGrid::WordBits)) - 1;
+            }
+        }
+        loadedLayers.push_back(std::move(newLayer));
+    }
+
+    layers = std::move(loadedLayers);
+    tileSize = static_cast<int>(fileTileSize);
+    return true;
+}
+
+#endif // !TILEMAPBINARYSERIALIZER_H
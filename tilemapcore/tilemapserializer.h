@@ -0,0 +1,477 @@
+#ifndef TILEMAPSERIALIZER_H
+#define TILEMAPSERIALIZER_H
+
+#include "mapmodel.h"
+#include "jsonwriter.h"
+#include "json.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+/*  object flow for saving and loading map data from files:
+    tileData = object that holds an individual tiles properties like position, index etc.
+    row = object that holds a full row of tileData objects
+    tiles = object that holds multiple row objects that make up a full layer
+    layerData = object that holds all data about a layer like dimensions, opacity, tiles etc.
+    mapData = object that holds every layer
+    tileData->row->tiles->layerData["tiles"]->mapData["layers"]
+*/
+
+// the file extension picks the format: ".tmb" is the binary format, anything else is json
+bool MapModel::IsBinaryFile(const std::string& filename)
+{
+    // case-insensitive check of the extension
+    const std::string extension = ".tmb";
+    if (filename.size() < extension.size()) return false;
+    return std::equal(extension.begin(), extension.end(),
+        filename.end() - extension.size(), [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a))
+                == std::tolower(static_cast<unsigned char>(b));
+        });
+}
+
+bool MapModel::SaveTileMap(const std::string& filename) const
+{
+    if (IsBinaryFile(filename)) return SaveTileMapBinary(filename);
+    return SaveTileMapJson(filename);
+}
+
+bool MapModel::LoadTileMap(const std::string& filename)
+{
+    bool loaded = IsBinaryFile(filename) ? LoadTileMapBinary(filename)
+        : LoadTileMapJson(filename);
+    if (loaded) {
+        // the history refers to the previous map's layers
+        undoStack.Clear();
+        ++modifyCount;
+    }
+    return loaded;
+}
+
+MapModel::MapSnapshot MapModel::TakeSnapshot() const
+{
+    // copying a layer shares its chunks, only the collision bits are duplicated
+    MapSnapshot snapshot;
+    snapshot.layers = layers;
+    snapshot.atlasColumns = atlasColumns;
+    snapshot.tileSize = tileSize;
+    return snapshot;
+}
+
+std::function<bool()> MapModel::MakeSaveJob(const std::string& filename) const
+{
+    auto snapshot = std::make_shared<const MapSnapshot>(TakeSnapshot());
+    bool isBinary = IsBinaryFile(filename);
+    return [snapshot, filename, isBinary]() {
+        // write next to the target and swap it in afterwards, so a crash or a failed
+        // write never leaves a half written map behind
+        std::string tempName = filename + ".tmp";
+        bool written = isBinary ? WriteTileMapBinary(*snapshot, tempName)
+            : WriteTileMapJson(*snapshot, tempName, false);
+        if (!written) return false;
+        std::error_code error;
+        std::filesystem::rename(tempName, filename, error);
+        if (error) {
+            std::cerr << "Failed to replace " << filename << ": " << error.message() << "\n";
+            return false;
+        }
+        return true;
+    };
+}
+
+std::uint64_t MapModel::GetContentRevision() const
+{
+    // grid revisions only ever grow, so their sum changes with every tile edit
+    std::uint64_t revision = modifyCount;
+    for (const auto& layer : layers) revision += layer.layer.GetRevision();
+    return revision;
+}
+
+bool MapModel::SaveTileMapJson(const std::string& filename, bool compact) const
+{
+    return WriteTileMapJson(TakeSnapshot(), filename, compact);
+}
+
+bool MapModel::WriteTileMapJson(const MapSnapshot& map, const std::string& filename,
+    bool compact)
+{
+    // the map is streamed out layer by layer and row by row, keys are written in the
+    // sorted order nlohmann's dump() used so existing files keep the same layout
+    std::vector<char> buffer(1 << 16);
+    std::ofstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.open(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file for saving: " << filename << "\n";
+        return false;
+    }
+    JsonWriter writer(file, compact ? -1 : 4);  // pretty-print with 4 space indentation for readability
+    writer.BeginObject();
+    writer.Key("layers");
+    writer.BeginArray();
+    std::vector<TileCell::Id> row;
+    int tileSize = map.tileSize;
+    for (const auto& layer : map.layers) {  // iterate over all TileLayer objects (layer) in the layers vector
+        writer.BeginObject();
+        // serialize the collision grid data for each layer
+        writer.Key("collisionGrid");
+        writer.BeginArray();
+        for (int y = 0; y < layer.height; ++y) {
+            writer.BeginArray();
+            for (int x = 0; x < layer.width; ++x) {
+                writer.Bool(layer.collisionGrid.Get(x, y)); // add collision state
+            }
+            writer.EndArray();
+        }
+        writer.EndArray();
+        writer.Key("height");
+        writer.Int(layer.height);
+        writer.Key("isVisible");
+        writer.Bool(layer.isVisible);
+        writer.Key("opacity");
+        writer.Float(layer.opacity);
+        // for each row (y) in the layer, write every tile (x), empty tiles are null
+        writer.Key("tiles");
+        writer.BeginArray();
+        row.resize(layer.width);
+        for (int y = 0; y < layer.height; ++y) {
+            layer.layer.ReadRow(0, y, layer.width, row.data());
+            writer.BeginArray();
+            for (int x = 0; x < layer.width; ++x) {
+                TileCell::Id tile = row[x];
+                if (TileCell::IsEmpty(tile)) {
+                    writer.Null();
+                    continue;
+                }
+                // derive the tile's properties from the packed cell
+                int index = TileCell::GetIndex(tile);
+                int rectLeft = (index % map.atlasColumns) * tileSize;
+                int rectTop = (index / map.atlasColumns) * tileSize;
+                writer.BeginObject();
+                if (TileCell::GetFlags(tile) != 0) {
+                    writer.Key("flags");
+                    writer.UInt(TileCell::GetFlags(tile));  // flip/rotate bits, only written when set
+                }
+                writer.Key("index");
+                writer.Int(index);
+                // positions are stored unscaled so they don't depend on the zoom level at save time
+                writer.Key("position");
+                writer.BeginObject();
+                writer.Key("x");
+                writer.Float(static_cast<float>(x * tileSize));
+                writer.Key("y");
+                writer.Float(static_cast<float>(y * tileSize));
+                writer.EndObject();
+                writer.Key("textureRect");
+                writer.BeginObject();
+                writer.Key("height");
+                writer.Int(tileSize);
+                writer.Key("left");
+                writer.Int(rectLeft);
+                writer.Key("top");
+                writer.Int(rectTop);
+                writer.Key("width");
+                writer.Int(tileSize);
+                writer.EndObject();
+                writer.EndObject();
+            }
+            writer.EndArray();
+        }
+        writer.EndArray();
+        writer.Key("width");
+        writer.Int(layer.width);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+    file.flush();
+    if (!file) {
+        std::cerr << "Failed to write map: " << filename << "\n";
+        return false;
+    }
+    return true;    // return true if saving succeeded
+}
+
+/*  streaming reader for the json map format, built on nlohmann's sax interface so the
+    document is never held in memory: cells and collision bits are written straight into
+    the layer grids while the file is parsed, only one row of each is buffered at a time.
+    object keys may come in any order (dump() sorts them, so "tiles" and "collisionGrid"
+    arrive before "width" and "height"), so the grids grow row by row and are cut to the
+    stored dimensions once the layer object ends
+*/
+class MapJsonReader : public nlohmann::json_sax<nlohmann::json> {
+public:
+    struct Layer {
+        int width = -1;             // -1 until the "width"/"height" keys are seen
+        int height = -1;
+        bool isVisible = true;
+        float opacity = 0.5f;
+        ChunkedGrid tiles;
+        BitGrid collisionGrid;
+        int tileRows = 0;           // rows read so far from "tiles" / "collisionGrid"
+        int collisionRows = 0;
+    };
+
+    MapJsonReader(int atlasColumns, int tileSize)
+        : atlasColumns(atlasColumns), tileSize(tileSize) {}
+
+    std::vector<Layer>& GetLayers() { return layers; }
+    // false unless the root was an object holding a "layers" array
+    bool HasLayers() const { return hasLayers; }
+
+    bool null() override { return Value(0.0, false, true); }
+    bool boolean(bool value) override { return Value(value ? 1.0 : 0.0, true, false); }
+    bool number_integer(number_integer_t value) override
+    {
+        return Value(static_cast<double>(value), false, false);
+    }
+    bool number_unsigned(number_unsigned_t value) override
+    {
+        return Value(static_cast<double>(value), false, false);
+    }
+    bool number_float(number_float_t value, const string_t&) override
+    {
+        return Value(value, false, false);
+    }
+    bool string(string_t&) override { return Value(0.0, false, true); }
+    bool binary(binary_t&) override { return Value(0.0, false, true); }
+
+    bool key(string_t& value) override
+    {
+        currentKey = value;
+        return true;
+    }
+
+    bool start_object(std::size_t) override
+    {
+        Context parent = stack.empty() ? Context::None : stack.back();
+        if (parent == Context::None) {
+            stack.push_back(Context::Root);
+        }
+        else if (parent == Context::Layers) {
+            layers.emplace_back();
+            stack.push_back(Context::Layer);
+        }
+        else if (parent == Context::TileRow) {
+            // a tile object, the index is read from "index" or derived from "textureRect"
+            tileIndex = -1;
+            tileFlags = 0;
+            rectLeft = rectTop = -1;
+            stack.push_back(Context::Tile);
+        }
+        else if (parent == Context::Tile && currentKey == "textureRect") {
+            stack.push_back(Context::TextureRect);
+        }
+        else {
+            stack.push_back(Context::Skip);
+        }
+        return true;
+    }
+
+    bool end_object() override
+    {
+        Context context = stack.back();
+        stack.pop_back();
+        if (context == Context::Tile) {
+            if (tileIndex < 0 && rectLeft >= 0 && rectTop >= 0) {
+                // older files only stored the texture rect
+                tileIndex = (rectTop / tileSize) * atlasColumns + (rectLeft / tileSize);
+            }
+            tileRow.push_back(tileIndex < 0 ? TileCell::Empty
+                : TileCell::Make(tileIndex, tileFlags));
+        }
+        else if (context == Context::Layer) {
+            return FinishLayer();
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) override
+    {
+        Context parent = stack.empty() ? Context::None : stack.back();
+        if (parent == Context::Root && currentKey == "layers") {
+            hasLayers = true;
+            stack.push_back(Context::Layers);
+        }
+        else if (parent == Context::Layer && currentKey == "tiles") {
+            stack.push_back(Context::Tiles);
+        }
+        else if (parent == Context::Layer && currentKey == "collisionGrid") {
+            stack.push_back(Context::Collision);
+        }
+        else if (parent == Context::Tiles) {
+            tileRow.clear();
+            stack.push_back(Context::TileRow);
+        }
+        else if (parent == Context::Collision) {
+            collisionRow.clear();
+            stack.push_back(Context::CollisionRow);
+        }
+        else {
+            stack.push_back(Context::Skip);
+        }
+        return true;
+    }
+
+    bool end_array() override
+    {
+        Context context = stack.back();
+        stack.pop_back();
+        if (context == Context::TileRow) FlushTileRow();
+        else if (context == Context::CollisionRow) FlushCollisionRow();
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&,
+        const nlohmann::detail::exception& error) override
+    {
+        std::cerr << "Failed to parse map at byte " << position << ": " << error.what() << "\n";
+        return false;
+    }
+
+private:
+    enum class Context { None, Root, Layers, Layer, Tiles, TileRow, Tile, TextureRect,
+        Collision, CollisionRow, Skip };
+
+    // every scalar ends up here, isNull covers null and values of the wrong type
+    bool Value(double value, bool isBool, bool isNull)
+    {
+        if (stack.empty()) return true;
+        switch (stack.back()) {
+        case Context::TileRow:
+            // null is an empty cell, anything else that isn't an object is treated the same
+            tileRow.push_back(TileCell::Empty);
+            break;
+        case Context::CollisionRow:
+            collisionRow.push_back(!isNull && value != 0.0);
+            break;
+        case Context::Tile:
+            if (isNull || isBool) break;
+            if (currentKey == "index") tileIndex = static_cast<int>(value);
+            else if (currentKey == "flags") {
+                tileFlags = static_cast<TileCell::Id>(value) & TileCell::FlagMask;
+            }
+            break;
+        case Context::TextureRect:
+            if (isNull || isBool) break;
+            if (currentKey == "left") rectLeft = static_cast<int>(value);
+            else if (currentKey == "top") rectTop = static_cast<int>(value);
+            break;
+        case Context::Layer: {
+            if (isNull) break;
+            Layer& layer = layers.back();
+            if (currentKey == "width") layer.width = static_cast<int>(value);
+            else if (currentKey == "height") layer.height = static_cast<int>(value);
+            else if (currentKey == "isVisible") layer.isVisible = value != 0.0;
+            else if (currentKey == "opacity") layer.opacity = static_cast<float>(value);
+            break;
+        }
+        default:
+            break;
+        }
+        return true;
+    }
+
+    // makes room for row y in both grids, the width only ever grows to the widest row
+    void GrowLayer(Layer& layer, int rowWidth, int y)
+    {
+        int width = std::max(layer.tiles.GetWidth(), rowWidth);
+        int height = std::max(layer.tiles.GetHeight(), y + 1);
+        if (width != layer.tiles.GetWidth() || height != layer.tiles.GetHeight()) {
+            layer.tiles.Resize(width, height);
+            layer.collisionGrid.Resize(width, height);
+        }
+    }
+
+    void FlushTileRow()
+    {
+        Layer& layer = layers.back();
+        int y = layer.tileRows++;
+        int count = static_cast<int>(tileRow.size());
+        GrowLayer(layer, count, y);
+        layer.tiles.WriteRow(0, y, count, tileRow.data());
+    }
+
+    void FlushCollisionRow()
+    {
+        Layer& layer = layers.back();
+        int y = layer.collisionRows++;
+        int count = static_cast<int>(collisionRow.size());
+        GrowLayer(layer, count, y);
+        BitGrid::Word* words = layer.collisionGrid.GetRow(y);
+        for (int x = 0; x < count; ++x) {
+            if (!collisionRow[x]) continue;
+            words[x / BitGrid::WordBits] |= BitGrid::Word(1) << (x % BitGrid::WordBits);
+        }
+    }
+
+    // cuts (or pads) the grids to the stored dimensions, missing keys fall back to
+    // the size of the row data
+    bool FinishLayer()
+    {
+        Layer& layer = layers.back();
+        if (layer.width < 0) layer.width = layer.tiles.GetWidth();
+        if (layer.height < 0) layer.height = std::max(layer.tileRows, layer.collisionRows);
+        if (layer.width < 0 || layer.height < 0) {
+            std::cerr << "Invalid layer size in map file\n";
+            return false;
+        }
+        layer.tiles.Resize(layer.width, layer.height);
+        layer.collisionGrid.Resize(layer.width, layer.height);
+        return true;
+    }
+
+    int atlasColumns;                       // to turn texture rects into atlas indices
+    int tileSize;
+    std::vector<Layer> layers;
+    std::vector<Context> stack;             // container nesting of the current value
+    std::string currentKey;                 // last key of the innermost object
+    std::vector<TileCell::Id> tileRow;      // the row being read, flushed at its end
+    std::vector<bool> collisionRow;
+    int tileIndex = -1;                     // fields of the tile object being read
+    TileCell::Id tileFlags = 0;
+    int rectLeft = -1;
+    int rectTop = -1;
+    bool hasLayers = false;
+};
+
+bool MapModel::LoadTileMapJson(const std::string& filename)
+{
+    // open the file specified during the ui interaction
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file for loading: " << filename << "\n";
+        return false;
+    }
+    // stream the file through the sax reader, a broken file leaves the current map untouched
+    MapJsonReader reader(atlasColumns, tileSize);
+    if (!nlohmann::json::sax_parse(file, &reader)) {
+        std::cerr << "Failed to load map: " << filename << "\n";
+        return false;
+    }
+    // valid json that isn't a map would otherwise load as an empty map
+    if (!reader.HasLayers()) {
+        std::cerr << "Failed to load map, no \"layers\" array: " << filename << "\n";
+        return false;
+    }
+
+    std::vector<Layer> loadedLayers;
+    for (MapJsonReader::Layer& layerData : reader.GetLayers()) {
+        Layer newLayer;
+        newLayer.width = layerData.width;
+        newLayer.height = layerData.height;
+        newLayer.isVisible = layerData.isVisible;
+        newLayer.opacity = layerData.opacity;
+        newLayer.index = static_cast<int>(loadedLayers.size());   // set this new layer's index to match it's original index in the layers vector
+        newLayer.layer = std::move(layerData.tiles);
+        newLayer.collisionGrid = std::move(layerData.collisionGrid);
+        loadedLayers.push_back(std::move(newLayer));
+    }
+    layers = std::move(loadedLayers);
+    // return true if loading succeeded
+    return true;
+}
+
+#endif // !TILEMAPSERIALIZER_H
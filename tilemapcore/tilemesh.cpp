@@ -0,0 +1,70 @@
+#include "tilemesh.h"
+#include <utility>
+
+void TileMeshCache::Reset(const ChunkedGrid& grid, int atlasColumns, float tileSize)
+{
+    // anything baked into the vertices changed, so every list is stale
+    if (grid.GetChunksX() != chunksX || grid.GetChunksY() != chunksY
+        || atlasColumns != this->atlasColumns || tileSize != this->tileSize)
+    {
+        chunksX = grid.GetChunksX();
+        chunksY = grid.GetChunksY();
+        this->atlasColumns = atlasColumns;
+        this->tileSize = tileSize;
+        meshes.clear();
+    }
+    if (meshes.size() != static_cast<size_t>(chunksX) * chunksY) {
+        meshes.assign(static_cast<size_t>(chunksX) * chunksY, ChunkMesh());
+    }
+}
+
+void TileMeshCache::BuildChunk(ChunkMesh& mesh, const ChunkedGrid& grid, int chunkX,
+    int chunkY)
+{
+    mesh.vertices.clear();
+    mesh.revision = grid.GetChunkRevision(chunkX, chunkY);
+    mesh.buildStamp = nextBuildStamp++;
+    mesh.isBuilt = true;
+
+    const ChunkedGrid::Chunk* chunk = grid.GetChunk(chunkX, chunkY);
+    if (!chunk) return;
+
+    int baseX = chunkX * ChunkedGrid::ChunkSize;
+    int baseY = chunkY * ChunkedGrid::ChunkSize;
+    int endX = std::min(ChunkedGrid::ChunkSize, grid.GetWidth() - baseX);
+    int endY = std::min(ChunkedGrid::ChunkSize, grid.GetHeight() - baseY);
+    for (int y = 0; y < endY; ++y) {
+        for (int x = 0; x < endX; ++x) {
+            TileCell::Id cell = chunk->cells[y * ChunkedGrid::ChunkSize + x];
+            if (!TileCell::IsEmpty(cell)) {
+                AppendTileQuad(mesh.vertices, cell, baseX + x, baseY + y, atlasColumns,
+                    tileSize);
+            }
+        }
+    }
+}
+
+void TileMeshCache::AppendTileQuad(std::vector<Vertex>& vertices, TileCell::Id cell,
+    int x, int y, int atlasColumns, float tileSize)
+{
+    int index = TileCell::GetIndex(cell);
+    float texLeft = static_cast<float>(index % atlasColumns) * tileSize;
+    float texTop = static_cast<float>(index / atlasColumns) * tileSize;
+    float left = x * tileSize;
+    float top = y * tileSize;
+
+    // quad corners in order top-left, top-right, bottom-right, bottom-left
+    static const int cornerU[4] = { 0, 1, 1, 0 };
+    static const int cornerV[4] = { 0, 0, 1, 1 };
+    for (int i = 0; i < 4; ++i) {
+        // map the screen corner back into the texture: undo the vertical and
+        // horizontal flips, then the diagonal flip (which swaps the axes)
+        int u = cornerU[i];
+        int v = cornerV[i];
+        if (cell & TileCell::FlipVertical) v = 1 - v;
+        if (cell & TileCell::FlipHorizontal) u = 1 - u;
+        if (cell & TileCell::FlipDiagonal) std::swap(u, v);
+        vertices.push_back({ left + cornerU[i] * tileSize, top + cornerV[i] * tileSize,
+            texLeft + u * tileSize, texTop + v * tileSize });
+    }
+}
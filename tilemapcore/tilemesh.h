@@ -0,0 +1,90 @@
+#ifndef TILEMESH_H
+#define TILEMESH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "chunkedgrid.h"
+
+/*  quad lists for drawing a layer, one per chunk of the layer's grid: four vertices per
+    painted cell, positions and texture coordinates in unscaled tile units. a chunk's
+    list is only rebuilt when the grid's revision stamp for that chunk changes (or the
+    atlas layout it was built with). nothing here depends on a graphics library, the
+    editor's ChunkMeshCache uploads the lists into vertex arrays and the benchmark
+    measures the same code without a window
+*/
+class TileMeshCache {
+public:
+    struct Vertex {
+        float x, y;
+        float u, v;
+    };
+
+    struct ChunkMesh {
+        std::vector<Vertex> vertices;
+        std::uint64_t revision = 0;     // grid revision the list was built from
+        std::uint64_t buildStamp = 0;   // unique per build, for caches of the list
+        bool isBuilt = false;
+    };
+
+    // rebuilds the stale chunks overlapping the visible cells and calls
+    // fn(chunkX, chunkY, mesh) for each of them, returns the vertices they hold
+    template <typename Fn>
+    size_t Update(const ChunkedGrid& grid, int atlasColumns, float tileSize,
+        int visibleLeft, int visibleTop, int visibleWidth, int visibleHeight, Fn&& fn);
+    size_t Update(const ChunkedGrid& grid, int atlasColumns, float tileSize,
+        int visibleLeft, int visibleTop, int visibleWidth, int visibleHeight)
+    {
+        return Update(grid, atlasColumns, tileSize, visibleLeft, visibleTop, visibleWidth,
+            visibleHeight, [](int, int, const ChunkMesh&) {});
+    }
+    // forces every chunk to be rebuilt on the next update
+    void Invalidate() { meshes.clear(); }
+
+    // appends the quad for a packed cell, flips are applied through the texture coords
+    static void AppendTileQuad(std::vector<Vertex>& vertices, TileCell::Id cell, int x,
+        int y, int atlasColumns, float tileSize);
+
+private:
+    // resets the chunk slots when the grid or the atlas layout changed
+    void Reset(const ChunkedGrid& grid, int atlasColumns, float tileSize);
+    void BuildChunk(ChunkMesh& mesh, const ChunkedGrid& grid, int chunkX, int chunkY);
+
+    std::vector<ChunkMesh> meshes;  // row-major, one per chunk slot of the grid
+    int chunksX = 0;
+    int chunksY = 0;
+    int atlasColumns = 0;
+    float tileSize = 0.f;
+    std::uint64_t nextBuildStamp = 1;
+};
+
+template <typename Fn>
+size_t TileMeshCache::Update(const ChunkedGrid& grid, int atlasColumns, float tileSize,
+    int visibleLeft, int visibleTop, int visibleWidth, int visibleHeight, Fn&& fn)
+{
+    Reset(grid, atlasColumns, tileSize);
+    if (visibleWidth <= 0 || visibleHeight <= 0) return 0;
+
+    // only chunks that intersect the visible cells are rebuilt
+    const int chunkSize = ChunkedGrid::ChunkSize;
+    int startChunkX = std::max(visibleLeft / chunkSize, 0);
+    int startChunkY = std::max(visibleTop / chunkSize, 0);
+    int endChunkX = std::min((visibleLeft + visibleWidth - 1) / chunkSize + 1, chunksX);
+    int endChunkY = std::min((visibleTop + visibleHeight - 1) / chunkSize + 1, chunksY);
+
+    size_t vertexCount = 0;
+    for (int chunkY = startChunkY; chunkY < endChunkY; ++chunkY) {
+        for (int chunkX = startChunkX; chunkX < endChunkX; ++chunkX) {
+            ChunkMesh& mesh = meshes[static_cast<size_t>(chunkY) * chunksX + chunkX];
+            // only chunks that were edited since the last build are rebuilt
+            if (!mesh.isBuilt || mesh.revision != grid.GetChunkRevision(chunkX, chunkY)) {
+                BuildChunk(mesh, grid, chunkX, chunkY);
+            }
+            vertexCount += mesh.vertices.size();
+            fn(chunkX, chunkY, static_cast<const ChunkMesh&>(mesh));
+        }
+    }
+    return vertexCount;
+}
+
+#endif // !TILEMESH_H
@@ -0,0 +1,157 @@
+#include "undostack.h"
+#include <algorithm>
+
+size_t UndoStack::Entry::GetMemoryUsage() const
+{
+    return sizeof(Entry) + tiles.capacity() * sizeof(TileDiff)
+        + collisions.capacity() * sizeof(CollisionDiff);
+}
+
+UndoStack::UndoStack(size_t memoryLimit)
+    : memoryLimit(memoryLimit)
+{
+}
+
+std::uint64_t UndoStack::CellKey(int layer, int x, int y)
+{
+    // 16 bits of layer, 24 bits per coordinate is plenty for any map size
+    return (static_cast<std::uint64_t>(layer & 0xFFFF) << 48)
+        | (static_cast<std::uint64_t>(y & 0xFFFFFF) << 24)
+        | static_cast<std::uint64_t>(x & 0xFFFFFF);
+}
+
+void UndoStack::BeginStroke()
+{
+    if (isInStroke) EndStroke();
+    isInStroke = true;
+}
+
+void UndoStack::EndStroke()
+{
+    if (!isInStroke) return;
+    isInStroke = false;
+    Commit();
+}
+
+void UndoStack::RecordTile(int layer, int x, int y, TileCell::Id before, TileCell::Id after)
+{
+    if (before == after) return;
+    auto found = strokeTiles.find(CellKey(layer, x, y));
+    if (found != strokeTiles.end()) {
+        // the cell was already changed in this stroke, keep its original value
+        stroke.tiles[found->second].after = after;
+    }
+    else {
+        strokeTiles.emplace(CellKey(layer, x, y), stroke.tiles.size());
+        stroke.tiles.push_back({ layer, x, y, before, after });
+    }
+    if (!isInStroke) Commit();
+}
+
+void UndoStack::RecordCollision(int layer, int x, int y, bool before, bool after)
+{
+    if (before == after) return;
+    auto found = strokeCollisions.find(CellKey(layer, x, y));
+    if (found != strokeCollisions.end()) {
+        stroke.collisions[found->second].after = after;
+    }
+    else {
+        strokeCollisions.emplace(CellKey(layer, x, y), stroke.collisions.size());
+        stroke.collisions.push_back({ layer, x, y, 1, before, after });
+    }
+    if (!isInStroke) Commit();
+}
+
+void UndoStack::RecordTileRow(int layer, int x, int y, int count, const TileCell::Id* before,
+    const TileCell::Id* after, bool isNewCells)
+{
+    // record the whole row as one edit when outside a stroke
+    bool isImplicitStroke = !isInStroke;
+    isInStroke = true;
+    // later single cell records must not fold into diffs from before this row, or
+    // redo would write their values before the row's
+    if (isNewCells) strokeTiles.clear();
+    for (int i = 0; i < count; ++i) {
+        if (before[i] == after[i]) continue;
+        if (isNewCells) stroke.tiles.push_back({ layer, x + i, y, before[i], after[i] });
+        else RecordTile(layer, x + i, y, before[i], after[i]);
+    }
+    if (isImplicitStroke) EndStroke();
+}
+
+void UndoStack::RecordCollisionRow(int layer, int x, int y, int count, bool before, bool after)
+{
+    if (count > 0 && before != after) {
+        strokeCollisions.clear();
+        stroke.collisions.push_back({ layer, x, y, count, before, after });
+    }
+    if (!isInStroke) Commit();
+}
+
+void UndoStack::Commit()
+{
+    strokeTiles.clear();
+    strokeCollisions.clear();
+    // cells that were changed and changed back within the stroke cancel out
+    auto tileEnd = std::remove_if(stroke.tiles.begin(), stroke.tiles.end(),
+        [](const TileDiff& diff) { return diff.before == diff.after; });
+    stroke.tiles.erase(tileEnd, stroke.tiles.end());
+    auto collisionEnd = std::remove_if(stroke.collisions.begin(), stroke.collisions.end(),
+        [](const CollisionDiff& diff) { return diff.before == diff.after; });
+    stroke.collisions.erase(collisionEnd, stroke.collisions.end());
+    if (stroke.IsEmpty()) return;
+
+    // a new edit invalidates everything that was undone
+    for (const auto& entry : redoEntries) memoryUsage -= entry.GetMemoryUsage();
+    redoEntries.clear();
+
+    stroke.tiles.shrink_to_fit();
+    stroke.collisions.shrink_to_fit();
+    memoryUsage += stroke.GetMemoryUsage();
+    undoEntries.push_back(std::move(stroke));
+    stroke = Entry();
+    EnforceLimit();
+}
+
+void UndoStack::EnforceLimit()
+{
+    // drop the oldest history first, the newest entry is always kept
+    while (memoryUsage > memoryLimit && undoEntries.size() > 1) {
+        memoryUsage -= undoEntries.front().GetMemoryUsage();
+        undoEntries.pop_front();
+    }
+}
+
+const UndoStack::Entry* UndoStack::Undo()
+{
+    EndStroke();
+    if (undoEntries.empty()) return nullptr;
+    redoEntries.push_back(std::move(undoEntries.back()));
+    undoEntries.pop_back();
+    return &redoEntries.back();
+}
+
+const UndoStack::Entry* UndoStack::Redo()
+{
+    EndStroke();
+    if (redoEntries.empty()) return nullptr;
+    undoEntries.push_back(std::move(redoEntries.back()));
+    redoEntries.pop_back();
+    return &undoEntries.back();
+}
+
+void UndoStack::Clear()
+{
+    undoEntries.clear();
+    redoEntries.clear();
+    stroke = Entry();
+    strokeTiles.clear();
+    strokeCollisions.clear();
+    memoryUsage = 0;
+}
+
+void UndoStack::SetMemoryLimit(size_t bytes)
+{
+    memoryLimit = bytes;
+    EnforceLimit();
+}
@@ -0,0 +1,92 @@
+#ifndef UNDOSTACK_H
+#define UNDOSTACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "tilecell.h"
+
+/*  undo/redo history made of cell diffs: an entry only stores the cells an edit
+    actually changed (old and new packed id, or old and new collision bit), never a
+    copy of a layer. everything recorded between BeginStroke() and EndStroke() becomes
+    one entry, and a cell touched several times during a stroke keeps a single diff
+    (first old value, last new value). the oldest entries are dropped once the
+    history grows past the memory limit
+*/
+class UndoStack {
+public:
+    struct TileDiff {
+        int layer;
+        int x;
+        int y;
+        TileCell::Id before;
+        TileCell::Id after;
+    };
+
+    // a horizontal run of count cells that all had the same bit before and after
+    struct CollisionDiff {
+        int layer;
+        int x;
+        int y;
+        int count;
+        bool before;
+        bool after;
+    };
+
+    struct Entry {
+        std::vector<TileDiff> tiles;
+        std::vector<CollisionDiff> collisions;
+
+        bool IsEmpty() const { return tiles.empty() && collisions.empty(); }
+        size_t GetMemoryUsage() const;
+    };
+
+    explicit UndoStack(size_t memoryLimit = 64 * 1024 * 1024);
+
+    // strokes group edits into one entry, recording outside a stroke makes an entry per edit
+    void BeginStroke();
+    void EndStroke();
+    bool IsInStroke() const { return isInStroke; }
+
+    void RecordTile(int layer, int x, int y, TileCell::Id before, TileCell::Id after);
+    void RecordCollision(int layer, int x, int y, bool before, bool after);
+    // bulk versions for rows of cells. isNewCells appends the row without the per-cell
+    // coalescing, so a cell can appear in several diffs of a stroke; undo and redo
+    // apply the diffs in order. collision rows never coalesce
+    void RecordTileRow(int layer, int x, int y, int count, const TileCell::Id* before,
+        const TileCell::Id* after, bool isNewCells = false);
+    void RecordCollisionRow(int layer, int x, int y, int count, bool before, bool after);
+
+    // move the newest entry between the stacks and return it so the caller can apply
+    // it (before values for undo, after values for redo), nullptr when there is none.
+    // the pointer stays valid until the next call that changes the history
+    const Entry* Undo();
+    const Entry* Redo();
+    bool CanUndo() const { return !undoEntries.empty(); }
+    bool CanRedo() const { return !redoEntries.empty(); }
+
+    void Clear();
+    void SetMemoryLimit(size_t bytes);
+    size_t GetMemoryLimit() const { return memoryLimit; }
+    size_t GetMemoryUsage() const { return memoryUsage; }
+
+private:
+    static std::uint64_t CellKey(int layer, int x, int y);
+    void Commit();
+    void EnforceLimit();
+
+    std::deque<Entry> undoEntries;  // oldest first
+    std::deque<Entry> redoEntries;  // most recently undone last
+    size_t memoryLimit;
+    size_t memoryUsage = 0;         // sum over both stacks
+
+    Entry stroke;                   // entry being recorded
+    bool isInStroke = false;
+    // diff index per cell of the open stroke, for coalescing repeated edits
+    std::unordered_map<std::uint64_t, size_t> strokeTiles;
+    std::unordered_map<std::uint64_t, size_t> strokeCollisions;
+};
+
+#endif // !UNDOSTACK_H
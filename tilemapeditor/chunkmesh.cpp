@@ -0,0 +1,51 @@
+#include "chunkmesh.h"
+#include "profiler.h"
+
+void ChunkMeshCache::Draw(sf::RenderTarget& target, const ChunkedGrid& grid,
+    const sf::Texture& atlas, int atlasColumns, float tileSize, sf::Color color,
+    sf::RenderStates states, const sf::IntRect& visibleTiles)
+{
+    // the color is only baked into the uploaded vertices, the quad lists stay valid
+    size_t chunkCount = static_cast<size_t>(grid.GetChunksX()) * grid.GetChunksY();
+    if (grid.GetChunksX() != chunksX || uploads.size() != chunkCount
+        || color != this->color)
+    {
+        chunksX = grid.GetChunksX();
+        this->color = color;
+        uploads.clear();
+        uploads.resize(chunkCount);
+    }
+
+    states.texture = &atlas;
+    meshes.Update(grid, atlasColumns, tileSize, visibleTiles.left, visibleTiles.top,
+        visibleTiles.width, visibleTiles.height,
+        [&](int chunkX, int chunkY, const TileMeshCache::ChunkMesh& mesh) {
+            ChunkUpload& upload = uploads[static_cast<size_t>(chunkY) * chunksX + chunkX];
+            // copy the quad list again only after the core rebuilt it
+            if (upload.buildStamp != mesh.buildStamp) {
+                int cellsX = std::min(ChunkedGrid::ChunkSize,
+                    grid.GetWidth() - chunkX * ChunkedGrid::ChunkSize);
+                int cellsY = std::min(ChunkedGrid::ChunkSize,
+                    grid.GetHeight() - chunkY * ChunkedGrid::ChunkSize);
+                PROFILE_COUNT(TilesVisited, cellsX * cellsY);
+                upload.vertices.resize(mesh.vertices.size());
+                for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+                    const TileMeshCache::Vertex& vertex = mesh.vertices[i];
+                    upload.vertices[i] = sf::Vertex(sf::Vector2f(vertex.x, vertex.y),
+                        this->color, sf::Vector2f(vertex.u, vertex.v));
+                }
+                upload.buildStamp = mesh.buildStamp;
+            }
+            if (upload.vertices.getVertexCount() > 0) {
+                target.draw(upload.vertices, states);
+                PROFILE_COUNT(DrawCalls, 1);
+                PROFILE_COUNT(Vertices, upload.vertices.getVertexCount());
+            }
+        });
+}
+
+void ChunkMeshCache::Invalidate()
+{
+    meshes.Invalidate();
+    uploads.clear();
+}
@@ -0,0 +1,37 @@
+#ifndef CHUNKMESH_H
+#define CHUNKMESH_H
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "tilemesh.h"
+
+/*  render cache for one layer: the quad lists come from the core TileMeshCache (one
+    per chunk of the layer's grid), this class only uploads them into vertex arrays
+    that reference the atlas texture, so a whole layer is drawn with one draw call per
+    painted chunk. a chunk is only uploaded again when its quad list was rebuilt (or
+    when the color changes)
+*/
+class ChunkMeshCache {
+public:
+    // rebuilds stale meshes and draws the painted chunks that overlap visibleTiles
+    // (in cells) with the given states, positions are in unscaled tile units
+    void Draw(sf::RenderTarget& target, const ChunkedGrid& grid, const sf::Texture& atlas,
+        int atlasColumns, float tileSize, sf::Color color, sf::RenderStates states,
+        const sf::IntRect& visibleTiles);
+    // forces every chunk to be rebuilt on the next draw
+    void Invalidate();
+
+private:
+    struct ChunkUpload {
+        sf::VertexArray vertices{ sf::Quads };
+        std::uint64_t buildStamp = 0;   // build of the quad list the vertices hold
+    };
+
+    TileMeshCache meshes;
+    std::vector<ChunkUpload> uploads;   // row-major, one per chunk slot of the grid
+    int chunksX = 0;
+    sf::Color color;
+};
+
+#endif // !CHUNKMESH_H
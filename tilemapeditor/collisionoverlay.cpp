@@ -0,0 +1,64 @@
+#include "collisionoverlay.h"
+#include "profiler.h"
+#include <algorithm>
+
+void CollisionOverlayCache::Draw(sf::RenderTarget& target, const BitGrid& grid,
+    float tileSize, sf::Color color, const sf::RenderStates& states,
+    const sf::IntRect& visibleTiles)
+{
+    if (tileSize != this->tileSize || color != this->color) {
+        this->tileSize = tileSize;
+        this->color = color;
+        quads.clear();
+    }
+    if (visibleTiles.width <= 0 || visibleTiles.height <= 0) return;
+    // only the chunks whose bits changed are remeshed
+    mesh.Update(grid, visibleTiles.left, visibleTiles.top, visibleTiles.width,
+        visibleTiles.height);
+    int chunksX = mesh.GetChunksX();
+    if (quads.size() != static_cast<size_t>(chunksX) * mesh.GetChunksY()) {
+        quads.assign(static_cast<size_t>(chunksX) * mesh.GetChunksY(), ChunkQuads());
+    }
+
+    const int chunkSize = CollisionMesh::ChunkSize;
+    int startChunkX = std::max(visibleTiles.left / chunkSize, 0);
+    int startChunkY = std::max(visibleTiles.top / chunkSize, 0);
+    int endChunkX = std::min((visibleTiles.left + visibleTiles.width - 1) / chunkSize + 1,
+        chunksX);
+    int endChunkY = std::min((visibleTiles.top + visibleTiles.height - 1) / chunkSize + 1,
+        mesh.GetChunksY());
+    for (int chunkY = startChunkY; chunkY < endChunkY; ++chunkY) {
+        for (int chunkX = startChunkX; chunkX < endChunkX; ++chunkX) {
+            ChunkQuads& chunk = quads[static_cast<size_t>(chunkY) * chunksX + chunkX];
+            std::uint64_t revision = mesh.GetChunkRevision(chunkX, chunkY);
+            if (chunk.revision != revision) {
+                // one quad per rectangle
+                const std::vector<CollisionMesh::Rect>& rects
+                    = mesh.GetChunkRects(chunkX, chunkY);
+                chunk.vertices.resize(rects.size() * 4);
+                for (size_t i = 0; i < rects.size(); ++i) {
+                    float left = rects[i].x * tileSize;
+                    float top = rects[i].y * tileSize;
+                    float right = (rects[i].x + rects[i].width) * tileSize;
+                    float bottom = (rects[i].y + rects[i].height) * tileSize;
+                    chunk.vertices[i * 4] = sf::Vertex(sf::Vector2f(left, top), color);
+                    chunk.vertices[i * 4 + 1] = sf::Vertex(sf::Vector2f(right, top), color);
+                    chunk.vertices[i * 4 + 2] = sf::Vertex(sf::Vector2f(right, bottom), color);
+                    chunk.vertices[i * 4 + 3] = sf::Vertex(sf::Vector2f(left, bottom), color);
+                }
+                chunk.revision = revision;
+            }
+            if (chunk.vertices.getVertexCount() > 0) {
+                target.draw(chunk.vertices, states);
+                PROFILE_COUNT(DrawCalls, 1);
+                PROFILE_COUNT(Vertices, chunk.vertices.getVertexCount());
+            }
+        }
+    }
+}
+
+void CollisionOverlayCache::Invalidate()
+{
+    mesh.Invalidate();
+    quads.clear();
+}
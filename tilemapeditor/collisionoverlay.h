@@ -0,0 +1,34 @@
+#ifndef COLLISIONOVERLAY_H
+#define COLLISIONOVERLAY_H
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "collisionmesh.h"
+
+/*  render cache for one layer's collision overlay: the collision bits are greedy-meshed
+    into rectangles per chunk (see CollisionMesh) and every chunk keeps a quad array of
+    its rectangles, so a solid area costs a few quads and each chunk one draw call.
+    a chunk's quads are only rebuilt when its rectangles changed
+*/
+class CollisionOverlayCache {
+public:
+    // remeshes changed chunks and draws the ones that overlap visibleTiles (in cells),
+    // positions are in unscaled tile units like the chunk meshes
+    void Draw(sf::RenderTarget& target, const BitGrid& grid, float tileSize,
+        sf::Color color, const sf::RenderStates& states, const sf::IntRect& visibleTiles);
+    // forces every chunk to be rebuilt on the next draw
+    void Invalidate();
+
+private:
+    struct ChunkQuads {
+        sf::VertexArray vertices{ sf::Quads };
+        std::uint64_t revision = 0;     // mesh revision the quads were built from
+    };
+
+    CollisionMesh mesh;
+    std::vector<ChunkQuads> quads;  // row-major, same slots as the mesh chunks
+    float tileSize = 0.f;
+    sf::Color color;
+};
+
+#endif // !COLLISIONOVERLAY_H
@@ -2,6 +2,10 @@
 #include "ui.h"
 #include "tilemap.h"
 #include "tileatlas.h"
+#include "autosaver.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
 
 // default editor constructor because editor is the core manager
 Editor::Editor()
@@ -13,7 +17,7 @@ Editor::Editor()
     auto windowHeight = static_cast<float>(window.getSize().y);
 
     // initialize default zoom level to match normal rendering
-    float defaultZoomFactor = static_cast<float>(zoomLevels[currentZoomIndex])
+    float defaultZoomFactor = static_cast<float>(zoomLevels[atlasZoomIndex])
         / zoomLevels[0];
 
     InitializeUIView(uiView, window);
@@ -35,6 +39,9 @@ void Editor::InitializeClass()
     tileAtlas->Initialize();
     tileMap = std::make_shared<TileMap>(*this, *tileAtlas);
     // no tileMap initialization because it gets created upon ui interaction
+    autoSaver = std::make_shared<AutoSaver>();
+    autosavedRevision = tileMap->GetContentRevision();
+    SetFramePacing(framePacing);
 }
 
 void Editor::Run()
@@ -43,9 +50,162 @@ void Editor::Run()
     while (window.isOpen()) {
         // use deltatime to make actions relative to time not framerate
         float deltaTime = clock.restart().asSeconds();
+        Profiler::Get().BeginFrame();
         HandleEvents(deltaTime);
-        Render(window);
+        // commit the cells painted during this frame's events as one batch
+        {
+            PROFILE_SCOPE("TileMap::FlushStroke");
+            tileMap->FlushStroke();
+        }
+        // pans and zooms are recorded once per frame, whatever caused them
+        tileMap->GetEditLog().RecordView(layerViewOffset.x, layerViewOffset.y,
+            layerScaleFactor);
+        UpdateAutosave();
+        if (NeedsRedraw()) {
+            Render(window);
+        }
+        else {
+            // nothing on screen would change, give the cpu back until something happens
+            WaitForInput();
+        }
+        Profiler::Get().EndFrame();
+    }
+}
+
+bool Editor::NeedsRedraw() const
+{
+    // the profiler overlay is the only thing animating on its own
+    return needsRedraw || tileMap->NeedsRedraw() || tileAtlas->NeedsRedraw()
+        || ui->NeedsRedraw() || Profiler::Get().IsOverlayVisible();
+}
+
+void Editor::WaitForInput()
+{
+    sf::Time timeLeft;
+    sf::Time checkStep;
+    if (!GetNextDeadline(timeLeft, checkStep)) {
+        // nothing is due without input
+        hasPendingEvent = window.waitEvent(pendingEvent);
+        return;
+    }
+    // only the event queue is checked until the deadline, not the rest of the frame
+    sf::Clock waitClock;
+    while (waitClock.getElapsedTime() < timeLeft) {
+        if (window.pollEvent(pendingEvent)) {
+            hasPendingEvent = true;
+            return;
+        }
+        sf::sleep(std::min(checkStep, timeLeft - waitClock.getElapsedTime()));
+    }
+}
+
+bool Editor::GetNextDeadline(sf::Time& timeLeft, sf::Time& checkStep) const
+{
+    bool hasDeadline = false;
+    auto addDeadline = [&](sf::Time time) {
+        if (!hasDeadline || time < timeLeft) timeLeft = time;
+        hasDeadline = true;
+    };
+    // the pending autosave alone is checked on coarse steps, its timing isn't critical
+    checkStep = autosaveWaitStep;
+    // a save on the worker reports back when it finishes
+    if (autoSaver->IsBusy() || autoSaver->HasResults()) {
+        addDeadline(waitStep);
+        checkStep = waitStep;
+    }
+    // the autosave only has something to write after an edit
+    if (tileMap->GetContentRevision() != autosavedRevision) {
+        addDeadline(sf::seconds(autosaveInterval) - autosaveClock.getElapsedTime());
+    }
+    // the status message disappears without input
+    sf::Time statusTimeLeft = ui->GetStatusTimeLeft();
+    if (statusTimeLeft > sf::Time::Zero) {
+        addDeadline(statusTimeLeft);
+        checkStep = waitStep;
+    }
+    return hasDeadline;
+}
+
+void Editor::SetFramePacing(FramePacing pacing)
+{
+    framePacing = pacing;
+    window.setVerticalSyncEnabled(pacing == FramePacing::VSync);
+    window.setFramerateLimit(pacing == FramePacing::Limited ? frameRateLimit : 0);
+}
+
+void Editor::CycleFramePacing()
+{
+    switch (framePacing) {
+    case FramePacing::VSync:
+        SetFramePacing(FramePacing::Limited);
+        ui->SetStatus("Frame pacing: " + std::to_string(frameRateLimit) + " fps limit");
+        break;
+    case FramePacing::Limited:
+        SetFramePacing(FramePacing::Unlimited);
+        ui->SetStatus("Frame pacing: unlimited");
+        break;
+    case FramePacing::Unlimited:
+        SetFramePacing(FramePacing::VSync);
+        ui->SetStatus("Frame pacing: vsync");
+        break;
+    }
+}
+
+void Editor::RequestSave(const std::string& filename)
+{
+    autoSaver->Submit(filename, tileMap->MakeSaveJob(filename));
+    ui->SetStatus("Saving " + filename + "...");
+}
+
+void Editor::UpdateAutosave()
+{
+    // report finished saves back to the ui
+    AutoSaver::Result result;
+    while (autoSaver->PollResult(result)) {
+        if (result.succeeded) {
+            ui->SetStatus("Saved " + result.target + " ("
+                + std::to_string(static_cast<int>(result.seconds * 1000.f)) + " ms)");
+        }
+        else {
+            ui->SetStatus("Failed to save " + result.target);
+        }
+    }
+
+    if (autosaveClock.getElapsedTime().asSeconds() < autosaveInterval) return;
+    autosaveClock.restart();
+    // only write when something changed since the last autosave
+    std::uint64_t revision = tileMap->GetContentRevision();
+    if (revision == autosavedRevision) return;
+    autosavedRevision = revision;
+    autoSaver->Submit(autosaveFilename, tileMap->MakeSaveJob(autosaveFilename));
+}
+
+void Editor::ToggleEditRecording()
+{
+    EditLog& editLog = tileMap->GetEditLog();
+    if (editLog.IsRecording()) {
+        StopEditRecording();
+        return;
+    }
+    // the log only holds changes, so replays start from a copy of the current map
+    tileMap->EndStroke();
+    if (!tileMap->SaveTileMap(editLogMapFilename)) {
+        ui->SetStatus("Failed to save " + editLogMapFilename);
+        return;
     }
+    editLog.Start();
+    ui->SetStatus("Recording edits to " + editLogFilename + " (f5 stops)");
+}
+
+void Editor::StopEditRecording()
+{
+    EditLog& editLog = tileMap->GetEditLog();
+    if (!editLog.IsRecording()) return;
+    tileMap->EndStroke();
+    editLog.Stop();
+    bool saved = editLog.Save(editLogFilename);
+    ui->SetStatus((saved ? "Recorded " : "Failed to write ")
+        + std::to_string(editLog.GetEvents().size()) + " events to " + editLogFilename);
 }
 
 void Editor::HandleResize(const sf::Event& event) {
@@ -70,14 +230,31 @@ void Editor::HandleResize(const sf::Event& event) {
 
 void Editor::HandleEvents(float deltaTime)
 {
+    PROFILE_SCOPE("Editor::HandleEvents");
     sf::Event event;
     inputDelay -= deltaTime;
 
-    bool isLeftMouseDragging = sf::Mouse::isButtonPressed(sf::Mouse::Left);
-    bool isRightMouseDragging = sf::Mouse::isButtonPressed(sf::Mouse::Right);
-    bool isMiddleMouseDragging = sf::Mouse::isButtonPressed(sf::Mouse::Middle);
+    // buttons and keys are sampled once per frame, not once per event
+    input.deltaTime = deltaTime;
+    input.isLeftDown = sf::Mouse::isButtonPressed(sf::Mouse::Left);
+    input.isRightDown = sf::Mouse::isButtonPressed(sf::Mouse::Right);
+    input.isMiddleDown = sf::Mouse::isButtonPressed(sf::Mouse::Middle);
+    input.path.clear();
+    bool hasEvents = false;
+
+    while (PollNextEvent(event)) {
+        // any input may change what is shown (hover, drags, text), so redraw once
+        needsRedraw = true;
+        hasEvents = true;
+        PROFILE_COUNT(InputEvents, 1);
+        // consecutive moves only extend the path, it's handled once the burst ends
+        if (event.type == sf::Event::MouseMoved) {
+            input.path.emplace_back(event.mouseMove.x, event.mouseMove.y);
+            continue;
+        }
+        // anything else ends the burst, the motion before it is handled first
+        HandleMotion();
 
-    while (window.pollEvent(event)) {
         // global events
         if (event.type == sf::Event::Closed) {
             window.close();
@@ -86,32 +263,49 @@ void Editor::HandleEvents(float deltaTime)
             HandleResize(event);
             continue;
         }
-
-        ProcessKeyboardInputs();
-
-        // get the mouse position in different view coordinate systems
-        sf::Vector2i mousePos = sf::Mouse::getPosition(window);
-        sf::Vector2f atlasMousePos = window.mapPixelToCoords(mousePos, atlasView);
-        sf::Vector2f layerMousePos = window.mapPixelToCoords(mousePos, layerView);
-        sf::Vector2f uiMousePos = window.mapPixelToCoords(mousePos, uiView);
-
-        // delegate to view-specific handlers based on the viewport
-        if (GetViewportBounds(atlasView, window).contains(static_cast
-            <sf::Vector2f>(mousePos)))
-        {
-            HandleAtlasEvents(event, atlasMousePos, deltaTime,
-                isRightMouseDragging, isMiddleMouseDragging);
+        else if (event.type == sf::Event::MouseButtonReleased
+            && event.mouseButton.button == sf::Mouse::Left) {
+            // the drag ends wherever the button is released
+            tileMap->EndStroke();
+            ui->EndMinimapDrag();
         }
-        else if (GetViewportBounds(layerView, window).contains(
-            static_cast<sf::Vector2f>(mousePos)))
-        {
-            HandleLayerEvents(event, layerMousePos, deltaTime,
-                isLeftMouseDragging, isRightMouseDragging, isMiddleMouseDragging);
+        else if (event.type == sf::Event::KeyPressed && event.key.control
+            && !ui->IsTextInputActive()) {
+            // ctrl+z undoes, ctrl+y or ctrl+shift+z redoes
+            if (event.key.code == sf::Keyboard::Z && !event.key.shift) tileMap->Undo();
+            else if (event.key.code == sf::Keyboard::Y
+                || event.key.code == sf::Keyboard::Z) tileMap->Redo();
         }
-        else if (GetViewportBounds(uiView, window).contains(static_cast<
-            sf::Vector2f>(mousePos)))
-        {
-            HandleUIEvents(event, uiMousePos, deltaTime);
+        else if (event.type == sf::Event::KeyPressed && !ui->IsTextInputActive()) {
+            // f3 shows the profiler overlay (and records while it's shown), f4 writes
+            // the recorded frames for chrome://tracing, f5 records an edit session,
+            // f6 cycles the frame pacing
+            if (event.key.code == sf::Keyboard::F3) Profiler::Get().ToggleOverlay();
+            else if (event.key.code == sf::Keyboard::F4) {
+                bool exported = Profiler::Get().ExportChromeTrace(traceFilename);
+                ui->SetStatus((exported ? "Exported " : "Failed to export ") + traceFilename);
+            }
+            else if (event.key.code == sf::Keyboard::F5) ToggleEditRecording();
+            else if (event.key.code == sf::Keyboard::F6) CycleFramePacing();
+        }
+
+        // mouse events carry their own position, the views are only mapped for those
+        sf::Vector2i mousePos;
+        if (GetEventPosition(event, mousePos)) {
+            PROFILE_COUNT(InputDispatches, 1);
+            sf::Vector2f pixel = static_cast<sf::Vector2f>(mousePos);
+            // delegate to view-specific handlers based on the viewport
+            if (GetViewportBounds(atlasView, window).contains(pixel)) {
+                HandleAtlasEvents(event, window.mapPixelToCoords(mousePos, atlasView),
+                    deltaTime);
+            }
+            else if (GetViewportBounds(layerView, window).contains(pixel)) {
+                HandleLayerEvents(event, window.mapPixelToCoords(mousePos, layerView),
+                    deltaTime);
+            }
+            else if (GetViewportBounds(uiView, window).contains(pixel)) {
+                HandleUIEvents(event, window.mapPixelToCoords(mousePos, uiView), deltaTime);
+            }
         }
 
         // global text input handling for the UI
@@ -120,6 +314,56 @@ void Editor::HandleEvents(float deltaTime)
         // reset input delay
         inputDelay = 0.01f;
     }
+    // motion at the end of the frame
+    HandleMotion();
+
+    if (hasEvents) ProcessKeyboardInputs();
+}
+
+bool Editor::PollNextEvent(sf::Event& event)
+{
+    if (hasPendingEvent) {
+        event = pendingEvent;
+        hasPendingEvent = false;
+        return true;
+    }
+    return window.pollEvent(event);
+}
+
+bool Editor::GetEventPosition(const sf::Event& event, sf::Vector2i& position) const
+{
+    switch (event.type) {
+    case sf::Event::MouseButtonPressed:
+    case sf::Event::MouseButtonReleased:
+        position = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
+        return true;
+    case sf::Event::MouseWheelMoved:
+        position = sf::Vector2i(event.mouseWheel.x, event.mouseWheel.y);
+        return true;
+    case sf::Event::MouseWheelScrolled:
+        position = sf::Vector2i(event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void Editor::HandleMotion()
+{
+    if (input.path.empty()) return;
+    PROFILE_COUNT(InputDispatches, 1);
+    // the view under the end of the path gets the whole burst
+    sf::Vector2f pixel = static_cast<sf::Vector2f>(input.path.back());
+    if (GetViewportBounds(atlasView, window).contains(pixel)) {
+        HandleAtlasMotion(input);
+    }
+    else if (GetViewportBounds(layerView, window).contains(pixel)) {
+        HandleLayerMotion(input);
+    }
+    else if (GetViewportBounds(uiView, window).contains(pixel)) {
+        HandleUIMotion(input);
+    }
+    input.path.clear();
 }
 
 void Editor::ProcessKeyboardInputs()
@@ -137,8 +381,7 @@ void Editor::ProcessKeyboardInputs()
 }
 
 void Editor::HandleAtlasEvents(const sf::Event& event,
-    const sf::Vector2f& atlasMousePos, float deltaTime,
-    bool isRightDragging, bool isMiddleDragging)
+    const sf::Vector2f& atlasMousePos, float deltaTime)
 {
     if (event.type == sf::Event::MouseButtonPressed) {
         if (event.mouseButton.button == sf::Mouse::Right)
@@ -152,30 +395,34 @@ void Editor::HandleAtlasEvents(const sf::Event& event,
         else if (event.mouseButton.button == sf::Mouse::Middle)
             tileAtlas->HandlePanning(atlasMousePos, false, deltaTime);
     }
-    else if (event.type == sf::Event::MouseMoved) {
-        if (isRightDragging)
-            tileAtlas->HandleSelection(atlasMousePos, true, deltaTime);
-        if (isMiddleDragging)
-            tileAtlas->HandlePanning(atlasMousePos, true, deltaTime);
-    }
     else if (event.type == sf::Event::MouseWheelMoved) {
         // zoom in or out depending on wheel delta
         HandleAtlasZoom(atlasView, event.mouseWheel.delta, atlasOriginalViewSize);
     }
 }
 
+void Editor::HandleAtlasMotion(const InputFrame& input)
+{
+    // drags only need where the pointer ended up
+    if (!input.isRightDown && !input.isMiddleDown) return;
+    sf::Vector2f atlasMousePos = window.mapPixelToCoords(input.path.back(), atlasView);
+    if (input.isRightDown)
+        tileAtlas->HandleSelection(atlasMousePos, true, input.deltaTime);
+    if (input.isMiddleDown)
+        tileAtlas->HandlePanning(atlasMousePos, true, input.deltaTime);
+}
+
 void Editor::HandleLayerEvents(const sf::Event& event,
-    const sf::Vector2f& layerMousePos, float deltaTime, bool isLeftDragging,
-    bool isRightDragging, bool isMiddleDragging)
+    const sf::Vector2f& layerMousePos, float deltaTime)
 {
     if (event.type == sf::Event::MouseButtonPressed) {
         if (event.mouseButton.button == sf::Mouse::Left) {
-            if (tileMap->eraserActive)
-                tileMap->RemoveTile(layerMousePos);
-            else if (!tileMap->showCollisionOverlay)
-                tileMap->HandleTilePlacement(layerMousePos);
+            // every cell changed until the button is released is one undo step
+            tileMap->BeginStroke();
+            if (tileMap->bucketFillActive)
+                tileMap->HandleBucketFill(layerMousePos);
             else
-                tileMap->HandleCollisionPlacement(layerMousePos, true);
+                tileMap->StrokeTo(layerMousePos);
         }
         else if (event.mouseButton.button == sf::Mouse::Right) {
             tileMap->HandleSelection(layerMousePos, true, deltaTime);
@@ -190,23 +437,34 @@ void Editor::HandleLayerEvents(const sf::Event& event,
         else if (event.mouseButton.button == sf::Mouse::Middle)
             tileMap->HandlePanning(layerMousePos, false, deltaTime);
     }
-    else if (event.type == sf::Event::MouseMoved) {
-        if (isLeftDragging) {
-            if (tileMap->eraserActive)
-                tileMap->RemoveTile(layerMousePos);
-            else if (!tileMap->showCollisionOverlay)
-                tileMap->HandleTilePlacement(layerMousePos);
-            else
-                tileMap->HandleCollisionPlacement(layerMousePos, true);
-        }
-        if (isRightDragging)
-            tileMap->HandleSelection(layerMousePos, true, deltaTime);
-        if (isMiddleDragging)
-            tileMap->HandlePanning(layerMousePos, true, deltaTime);
+    else if (event.type == sf::Event::MouseWheelScrolled
+        && event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
+        // fractional deltas (touchpads, smooth wheels) zoom proportionally
+        HandleLayerZoom(layerView, event.mouseWheelScroll.delta, layerOriginalViewSize,
+            layerMousePos);
     }
-    else if (event.type == sf::Event::MouseWheelMoved) {
-        HandleLayerZoom(layerView, event.mouseWheel.delta, layerOriginalViewSize);
+}
+
+void Editor::HandleLayerMotion(const InputFrame& input)
+{
+    // a fill only happens on the click, not while dragging. painting follows every
+    // point of the path so curves stay curves, only the cells are queued here and
+    // they're written once per frame
+    if (input.isLeftDown && !tileMap->bucketFillActive) {
+        sf::FloatRect bounds = GetViewportBounds(layerView, window);
+        strokePath.clear();
+        for (const sf::Vector2i& point : input.path) {
+            if (!bounds.contains(static_cast<sf::Vector2f>(point))) continue;
+            strokePath.push_back(window.mapPixelToCoords(point, layerView));
+        }
+        tileMap->StrokeAlong(strokePath);
     }
+    if (!input.isRightDown && !input.isMiddleDown) return;
+    sf::Vector2f layerMousePos = window.mapPixelToCoords(input.path.back(), layerView);
+    if (input.isRightDown)
+        tileMap->HandleSelection(layerMousePos, true, input.deltaTime);
+    if (input.isMiddleDown)
+        tileMap->HandlePanning(layerMousePos, true, input.deltaTime);
 }
 
 void Editor::HandleUIEvents(const sf::Event& event, const sf::Vector2f& uiMousePos,
@@ -218,8 +476,15 @@ void Editor::HandleUIEvents(const sf::Event& event, const sf::Vector2f& uiMouseP
     }
 }
 
+void Editor::HandleUIMotion(const InputFrame& input)
+{
+    // dragging inside the minimap keeps moving the layer view
+    ui->HandleMinimapDrag(window.mapPixelToCoords(input.path.back(), uiView));
+}
+
 void Editor::Render(sf::RenderWindow& window)
 {
+    PROFILE_SCOPE("Editor::Render");
     window.clear();
 
     // ui rendering
@@ -248,8 +513,17 @@ void Editor::Render(sf::RenderWindow& window)
     window.draw(verticalSeparator);
     window.draw(horizontalSeparator);
 
+    // profiler overlay on top of everything, in window pixels
+    Profiler::Get().DrawOverlay(window, ui->GetFont());
+
     // display to window
     window.display();
+
+    // everything is on screen now, the next frame waits for another change
+    needsRedraw = false;
+    tileMap->MarkDrawn();
+    tileAtlas->MarkDrawn();
+    ui->MarkDrawn();
 }
 
 sf::FloatRect Editor::GetViewportBounds(const sf::View& view,
@@ -269,27 +543,27 @@ void Editor::HandleAtlasZoom(sf::View& view, float delta,
     const sf::Vector2f& originalSize)
 {
     // set new zoom index based on if scroll delta is positive or negative
-    int newZoomIndex = currentZoomIndex + (delta < 0 ? -1 : 1);
+    int newZoomIndex = atlasZoomIndex + (delta < 0 ? -1 : 1);
     newZoomIndex = std::clamp(newZoomIndex, 0, static_cast<int>(zoomLevels.size()) - 1);
-    if (newZoomIndex != currentZoomIndex) {
-        currentZoomIndex = newZoomIndex;
+    if (newZoomIndex != atlasZoomIndex) {
+        atlasZoomIndex = newZoomIndex;
         // scale relative to the base zoom level
-        atlasScaleFactor = static_cast<float>(zoomLevels[currentZoomIndex])
+        atlasScaleFactor = static_cast<float>(zoomLevels[atlasZoomIndex])
             / zoomLevels[0];
         tileAtlas->UpdateTileSize(atlasScaleFactor);
     }
 }
 
 void Editor::HandleLayerZoom(sf::View& view, float delta,
-    const sf::Vector2f& originalSize)
+    const sf::Vector2f& originalSize, const sf::Vector2f& anchor)
 {
-    int newZoomIndex = currentZoomIndex + (delta < 0 ? -1 : 1);
-    newZoomIndex = std::clamp(newZoomIndex, 0, static_cast<int>(zoomLevels.size()) - 1);
-    if (newZoomIndex != currentZoomIndex) {
-        currentZoomIndex = newZoomIndex;
-
-        layerScaleFactor = static_cast<float>(zoomLevels[currentZoomIndex])
-            / zoomLevels[0];
-        tileMap->UpdateTileScale(layerScaleFactor);
-    }
-}
\ No newline at end of file
+    float newScale = std::clamp(layerScaleFactor * std::pow(layerZoomStep, delta),
+        minLayerScale, maxLayerScale);
+    if (newScale == layerScaleFactor) return;
+
+    // keep the world position under the anchor fixed: view = world * scale - offset
+    sf::Vector2f world = (anchor + layerViewOffset) / layerScaleFactor;
+    layerViewOffset = world * newScale - anchor;
+    layerScaleFactor = newScale;
+    tileMap->UpdateTileScale(layerScaleFactor);
+}
@@ -3,11 +3,25 @@
 
 #include <SFML/Graphics.hpp>
 #include <iostream>
+#include <memory>
 #include "viewinitialization.h"
 
 class TileAtlas;
 class TileMap;
 class UI;
+class AutoSaver;
+
+/*  input of one frame: the mouse buttons are sampled once when the frame starts and
+    consecutive MouseMoved events are coalesced into one path, so a burst of motion
+    runs the tools once instead of once per event
+*/
+struct InputFrame {
+    float deltaTime = 0.f;
+    bool isLeftDown = false;
+    bool isRightDown = false;
+    bool isMiddleDown = false;
+    std::vector<sf::Vector2i> path;    // pointer positions in window pixels, oldest first
+};
 
 class Editor {
 private:
@@ -30,18 +44,58 @@ private:
 
     // variable to prevent too many inputs registering each frame
     float inputDelay = 0.05f;
+    InputFrame input;   // reused every frame
+    std::vector<sf::Vector2f> strokePath;   // input path in layer view coordinates
 
     // use pointer to these classes to avoid circular dependencies
     std::shared_ptr<UI> ui;
     std::shared_ptr<TileMap> tileMap;
     std::shared_ptr<TileAtlas> tileAtlas;
+    // saves run on this worker so the render loop never waits for the disk
+    std::shared_ptr<AutoSaver> autoSaver;
+
+    // periodic autosave, a crash loses at most one interval of edits
+    const float autosaveInterval = 60.f;    // seconds between autosaves
+    const std::string autosaveFilename = "autosave.tmb";
+    sf::Clock autosaveClock;
+    std::uint64_t autosavedRevision = 0;    // map content revision of the last autosave
+    const std::string traceFilename = "trace.json"; // profiler export (f4)
+    // edit session recording (f5), the map it starts from is saved next to the log
+    const std::string editLogFilename = "session.tml";
+    const std::string editLogMapFilename = "session_base.tmb";
+
+    // frames are only rendered when something changed: an input event, an edit, a
+    // finished save or a running animation. otherwise the loop blocks in WaitForInput
+    // until the next event, or until timed work (autosave, a save result, the status
+    // timeout) is due. the event that ends the wait is handed to HandleEvents first
+    bool needsRedraw = true;
+    sf::Event pendingEvent;
+    bool hasPendingEvent = false;
+    // sfml 2.6 has no waitEvent with a timeout, waits with a deadline check for input in
+    // the same 10 ms steps its waitEvent uses internally. while only the autosave is
+    // pending (up to a whole interval) the steps are coarser, the first event after
+    // a quiet spell can then be handled up to autosaveWaitStep late
+    const sf::Time waitStep = sf::milliseconds(10);
+    const sf::Time autosaveWaitStep = sf::milliseconds(250);
 
 public:
+    // how rendered frames are paced (f6 cycles): vsync, a fixed rate or unlimited
+    enum class FramePacing { VSync, Limited, Unlimited };
+    FramePacing framePacing = FramePacing::VSync;
+    const unsigned int frameRateLimit = 144;    // frames per second in Limited
+
     // variables to track zooming
-    const std::vector<int> zoomLevels = { 1, 4, 8 };    // zoom multiples
-    int currentZoomIndex = 0;  // start at the default zoom level
+    const std::vector<int> zoomLevels = { 1, 4, 8 };    // atlas zoom multiples
+    int atlasZoomIndex = 0;  // start at the default zoom level
     float atlasScaleFactor = 1.0f;
+    // the layer zoom is continuous, it only changes the render transform so any
+    // factor costs the same
     float layerScaleFactor = 1.0f;
+    // zoomed out past lodPixelsPerTile the layers are drawn from their lod pyramid, so
+    // the minimum has to go well below it (1/64 is a quarter pixel per tile)
+    const float minLayerScale = 1.f / 64.f;
+    const float maxLayerScale = 16.0f;
+    const float layerZoomStep = 1.15f;  // scale multiplier per wheel notch
     const float baseTileSize = 16.0f; // const tile size for zooming
 
     // variables to track panning offsets
@@ -53,24 +107,53 @@ public:
     void InitializeClass();
     void Run();
     void Render(sf::RenderWindow& window);
+    // snapshots the map and writes it on the save worker
+    void RequestSave(const std::string& filename);
+    void UpdateAutosave();
+    // starts recording the layer edits, or stops and writes the log
+    void ToggleEditRecording();
+    void StopEditRecording();
+    // applies a pacing mode to the window, CycleFramePacing steps to the next one
+    void SetFramePacing(FramePacing pacing);
+    void CycleFramePacing();
+    // forces the next loop iteration to render even without input
+    void RequestRedraw() { needsRedraw = true; }
+    bool NeedsRedraw() const;
+    // blocks until an event arrives or timed work is due
+    void WaitForInput();
+    // time until the next timed work without input and how often the event queue is
+    // checked meanwhile, false if there is none
+    bool GetNextDeadline(sf::Time& timeLeft, sf::Time& checkStep) const;
 
     // main event handling and input processing
     void HandleResize(const sf::Event& event);
     void HandleEvents(float deltaTime);
+    // the event that ended WaitForInput first, then the window's queue
+    bool PollNextEvent(sf::Event& event);
     void ProcessKeyboardInputs();
 
+    // window pixel position of mouse button and wheel events, false for other events
+    bool GetEventPosition(const sf::Event& event, sf::Vector2i& position) const;
+    // hands the coalesced motion of the frame to the view under its last point
+    void HandleMotion();
+
     // view-specific event handling
     void HandleAtlasEvents(const sf::Event& event, const sf::Vector2f& atlasMousePos,
-        float deltaTime, bool isRightDragging, bool isMiddleDragging);
+        float deltaTime);
     void HandleLayerEvents(const sf::Event& event, const sf::Vector2f& layerMousePos,
-        float deltaTime, bool isLeftDragging, bool isRightDragging, bool isMiddleDragging);
+        float deltaTime);
     void HandleUIEvents(const sf::Event& event, const sf::Vector2f& uiMousePos,
         float deltaTime);
+    // view-specific motion handling, once per burst of MouseMoved events
+    void HandleAtlasMotion(const InputFrame& input);
+    void HandleLayerMotion(const InputFrame& input);
+    void HandleUIMotion(const InputFrame& input);
     // zoom event handling
     void HandleAtlasZoom(sf::View& view, float delta,
         const sf::Vector2f& originalSize);
+    // zooms around anchor (in layer view coordinates) so the cell under it stays put
     void HandleLayerZoom(sf::View& view, float delta,
-        const sf::Vector2f& originalSize);
+        const sf::Vector2f& originalSize, const sf::Vector2f& anchor);
 
     // bounds getter function for views
     sf::FloatRect GetViewportBounds(const sf::View& view,
@@ -82,5 +165,6 @@ public:
     sf::View GetLayerView() const { return layerView; }
     const sf::RenderWindow& GetWindow() { return window; }
     std::shared_ptr<TileMap> GetTileMap() const { return tileMap; }
+    std::shared_ptr<TileAtlas> GetTileAtlas() const { return tileAtlas; }
 };
 #endif // !EDITOR_H
\ No newline at end of file
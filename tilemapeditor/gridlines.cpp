@@ -0,0 +1,74 @@
+#include "gridlines.h"
+#include "profiler.h"
+#include <algorithm>
+
+namespace {
+    const sf::Color gridColor(100, 100, 100, 150);
+}
+
+void GridLines::Update(int columns, int rows, float cellSize,
+    const sf::IntRect& visibleCells)
+{
+    // clip to the grid, nothing to do when none of it is visible
+    int left = std::max(visibleCells.left, 0);
+    int top = std::max(visibleCells.top, 0);
+    int right = std::min(visibleCells.left + visibleCells.width, columns);
+    int bottom = std::min(visibleCells.top + visibleCells.height, rows);
+    if (right <= left || bottom <= top) {
+        lines.clear();
+        cellRect = sf::IntRect();
+        isValid = false;
+        return;
+    }
+    sf::IntRect visible(left, top, right - left, bottom - top);
+
+    bool isCovered = isValid && cellRect.left <= visible.left && cellRect.top <= visible.top
+        && cellRect.left + cellRect.width >= right && cellRect.top + cellRect.height >= bottom;
+    // zooming in leaves a window far bigger than the screen behind
+    bool isOversized = cellRect.width > 4 * visible.width + 4
+        || cellRect.height > 4 * visible.height + 4;
+    if (isCovered && !isOversized && columns == this->columns && rows == this->rows
+        && cellSize == this->cellSize) return;
+
+    this->columns = columns;
+    this->rows = rows;
+    this->cellSize = cellSize;
+    // half a screen of margin on every side, so panning rarely rebuilds
+    int marginX = visible.width / 2 + 1;
+    int marginY = visible.height / 2 + 1;
+    left = std::max(left - marginX, 0);
+    top = std::max(top - marginY, 0);
+    right = std::min(right + marginX, columns);
+    bottom = std::min(bottom + marginY, rows);
+    Rebuild(sf::IntRect(left, top, right - left, bottom - top));
+}
+
+void GridLines::Rebuild(const sf::IntRect& cells)
+{
+    PROFILE_SCOPE("GridLines::Rebuild");
+    cellRect = cells;
+    isValid = true;
+    lines.resize(2 * (cells.width + 1) + 2 * (cells.height + 1));
+
+    float left = cells.left * cellSize;
+    float top = cells.top * cellSize;
+    float right = (cells.left + cells.width) * cellSize;
+    float bottom = (cells.top + cells.height) * cellSize;
+    std::size_t vertex = 0;
+    for (int x = cells.left; x <= cells.left + cells.width; ++x) {
+        lines[vertex++] = sf::Vertex(sf::Vector2f(x * cellSize, top), gridColor);
+        lines[vertex++] = sf::Vertex(sf::Vector2f(x * cellSize, bottom), gridColor);
+    }
+    for (int y = cells.top; y <= cells.top + cells.height; ++y) {
+        lines[vertex++] = sf::Vertex(sf::Vector2f(left, y * cellSize), gridColor);
+        lines[vertex++] = sf::Vertex(sf::Vector2f(right, y * cellSize), gridColor);
+    }
+}
+
+void GridLines::Draw(sf::RenderTarget& target, const sf::RenderStates& states) const
+{
+    if (!isValid) return;
+    target.draw(lines, states);
+    PROFILE_COUNT(DrawCalls, 1);
+    PROFILE_COUNT(Vertices, lines.getVertexCount());
+}
@@ -0,0 +1,30 @@
+#ifndef GRIDLINES_H
+#define GRIDLINES_H
+
+#include <SFML/Graphics.hpp>
+
+/*  cached line geometry for a grid of columns x rows square cells. only the lines of
+    a window around the visible cells are built, so a huge layer costs no more than the
+    screen shows. the geometry is kept until the visible cells leave that window, the
+    window has become much larger than what's visible (after zooming in), or the grid
+    or cell size changes. positions start at the grid origin, panning goes through the
+    render states so it never rebuilds anything
+*/
+class GridLines {
+public:
+    // visibleCells doesn't have to be clipped to the grid
+    void Update(int columns, int rows, float cellSize, const sf::IntRect& visibleCells);
+    void Draw(sf::RenderTarget& target, const sf::RenderStates& states) const;
+    void Invalidate() { isValid = false; }
+
+private:
+    void Rebuild(const sf::IntRect& cells);
+
+    sf::VertexArray lines{ sf::Lines };
+    sf::IntRect cellRect;   // cells the lines cover, clipped to the grid
+    int columns = 0;
+    int rows = 0;
+    float cellSize = 0.f;
+    bool isValid = false;
+};
+#endif // !GRIDLINES_H
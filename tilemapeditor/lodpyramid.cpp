@@ -0,0 +1,164 @@
+#include "lodpyramid.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+
+void LodPyramid::Draw(sf::RenderTarget& target, const ChunkedGrid& grid,
+    const std::vector<sf::Color>& tileColors, float tileSize, sf::Color color,
+    sf::RenderStates states, float pixelsPerTile)
+{
+    if (levels.empty() || grid.GetWidth() != levels[0].width
+        || grid.GetHeight() != levels[0].height || tileColors.size() != colorCount)
+    {
+        colorCount = tileColors.size();
+        Reset(grid);
+    }
+    if (levels.empty()) return;
+
+    // resample only the chunks that changed since the last draw
+    for (int chunkY = 0; chunkY < chunksY; ++chunkY) {
+        for (int chunkX = 0; chunkX < chunksX; ++chunkX) {
+            std::uint64_t& revision
+                = chunkRevisions[static_cast<size_t>(chunkY) * chunksX + chunkX];
+            if (revision == grid.GetChunkRevision(chunkX, chunkY)) continue;
+            revision = grid.GetChunkRevision(chunkX, chunkY);
+            UpdateChunk(grid, tileColors, chunkX, chunkY);
+        }
+    }
+
+    // one texel per 2^level cells, pick the level where a texel covers about a pixel,
+    // skipping levels that are too big for the graphics driver
+    int levelIndex = pixelsPerTile > 0.f
+        ? std::max(0, static_cast<int>(std::floor(std::log2(1.f / pixelsPerTile)))) : 0;
+    unsigned int maxSize = sf::Texture::getMaximumSize();
+    levelIndex = std::min(levelIndex, static_cast<int>(levels.size()) - 1);
+    while (levelIndex + 1 < static_cast<int>(levels.size())
+        && (static_cast<unsigned int>(levels[levelIndex].width) > maxSize
+            || static_cast<unsigned int>(levels[levelIndex].height) > maxSize))
+    {
+        ++levelIndex;
+    }
+    Level& level = levels[levelIndex];
+    Upload(level);
+    if (!level.hasTexture) return;
+
+    sf::Sprite sprite(level.texture);
+    float texelSize = tileSize * static_cast<float>(1 << levelIndex);
+    sprite.setScale(texelSize, texelSize);
+    sprite.setColor(color);
+    target.draw(sprite, states);
+    PROFILE_COUNT(DrawCalls, 1);
+    PROFILE_COUNT(Vertices, 4);
+}
+
+void LodPyramid::Reset(const ChunkedGrid& grid)
+{
+    levels.clear();
+    chunksX = grid.GetChunksX();
+    chunksY = grid.GetChunksY();
+    // everything starts transparent and unsampled, unallocated chunks (revision 0)
+    // are already correct that way
+    chunkRevisions.assign(static_cast<size_t>(chunksX) * chunksY, 0);
+    int width = grid.GetWidth();
+    int height = grid.GetHeight();
+    if (width <= 0 || height <= 0) return;
+    while (true) {
+        Level level;
+        level.width = width;
+        level.height = height;
+        level.pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+        level.dirtyTop = 0;
+        level.dirtyBottom = height;
+        levels.push_back(std::move(level));
+        if (width == 1 && height == 1) break;
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+}
+
+void LodPyramid::UpdateChunk(const ChunkedGrid& grid, const std::vector<sf::Color>& tileColors,
+    int chunkX, int chunkY)
+{
+    Level& base = levels[0];
+    int x0 = chunkX * ChunkedGrid::ChunkSize;
+    int y0 = chunkY * ChunkedGrid::ChunkSize;
+    int x1 = std::min(x0 + ChunkedGrid::ChunkSize, base.width);
+    int y1 = std::min(y0 + ChunkedGrid::ChunkSize, base.height);
+    PROFILE_COUNT(TilesVisited, (x1 - x0) * (y1 - y0));
+    const ChunkedGrid::Chunk* chunk = grid.GetChunk(chunkX, chunkY);
+    for (int y = y0; y < y1; ++y) {
+        std::uint8_t* texel = base.pixels.data()
+            + (static_cast<size_t>(y) * base.width + x0) * 4;
+        for (int x = x0; x < x1; ++x, texel += 4) {
+            TileCell::Id cell = chunk
+                ? chunk->cells[(y - y0) * ChunkedGrid::ChunkSize + (x - x0)] : TileCell::Empty;
+            int index = TileCell::GetIndex(cell);
+            sf::Color tileColor = index >= 0 && index < static_cast<int>(tileColors.size())
+                ? tileColors[index] : sf::Color::Transparent;
+            texel[0] = tileColor.r;
+            texel[1] = tileColor.g;
+            texel[2] = tileColor.b;
+            texel[3] = tileColor.a;
+        }
+    }
+    base.dirtyTop = std::min(base.dirtyTop, y0);
+    base.dirtyBottom = std::max(base.dirtyBottom, y1);
+
+    // carry the changed area up the pyramid, rounding outwards at every level
+    for (int levelIndex = 1; levelIndex < static_cast<int>(levels.size()); ++levelIndex) {
+        x0 /= 2;
+        y0 /= 2;
+        x1 = (x1 + 1) / 2;
+        y1 = (y1 + 1) / 2;
+        Downsample(levelIndex, x0, y0, x1, y1);
+    }
+}
+
+void LodPyramid::Downsample(int levelIndex, int x0, int y0, int x1, int y1)
+{
+    const Level& source = levels[levelIndex - 1];
+    Level& level = levels[levelIndex];
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            // alpha weighted average so transparent cells don't darken their neighbours
+            unsigned int sum[3] = { 0, 0, 0 };
+            unsigned int alpha = 0;
+            for (int sy = 2 * y; sy < std::min(2 * y + 2, source.height); ++sy) {
+                for (int sx = 2 * x; sx < std::min(2 * x + 2, source.width); ++sx) {
+                    const std::uint8_t* texel = source.pixels.data()
+                        + (static_cast<size_t>(sy) * source.width + sx) * 4;
+                    for (int c = 0; c < 3; ++c) sum[c] += texel[c] * texel[3];
+                    alpha += texel[3];
+                }
+            }
+            std::uint8_t* texel = level.pixels.data()
+                + (static_cast<size_t>(y) * level.width + x) * 4;
+            for (int c = 0; c < 3; ++c) {
+                texel[c] = static_cast<std::uint8_t>(alpha > 0 ? sum[c] / alpha : 0);
+            }
+            // missing texels past the edge count as transparent
+            texel[3] = static_cast<std::uint8_t>(alpha / 4);
+        }
+    }
+    level.dirtyTop = std::min(level.dirtyTop, y0);
+    level.dirtyBottom = std::max(level.dirtyBottom, y1);
+}
+
+void LodPyramid::Upload(Level& level)
+{
+    if (!level.hasTexture) {
+        if (!level.texture.create(level.width, level.height)) return;
+        level.texture.setSmooth(true);
+        level.hasTexture = true;
+        level.dirtyTop = 0;
+        level.dirtyBottom = level.height;
+    }
+    if (level.dirtyTop >= level.dirtyBottom) return;
+    // whole rows are contiguous, so the changed band goes up in one call
+    const std::uint8_t* rows = level.pixels.data()
+        + static_cast<size_t>(level.dirtyTop) * level.width * 4;
+    level.texture.update(rows, level.width, level.dirtyBottom - level.dirtyTop, 0,
+        level.dirtyTop);
+    level.dirtyTop = level.height;
+    level.dirtyBottom = 0;
+}
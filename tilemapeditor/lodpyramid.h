@@ -0,0 +1,52 @@
+#ifndef LODPYRAMID_H
+#define LODPYRAMID_H
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "chunkedgrid.h"
+
+/*  level of detail for zoomed out rendering: level 0 holds one texel per cell (the
+    average color of the cell's atlas tile, transparent when empty), every level above
+    is a 2x2 downsample of the one below. once tiles get smaller than a few pixels the
+    layer is drawn as a single textured quad from the level that maps closest to one
+    texel per pixel instead of tile by tile.
+    like the chunk meshes, only chunks whose revision stamp changed are recomputed, and
+    the change is carried up through the levels for just that chunk's area
+*/
+class LodPyramid {
+public:
+    // brings the pyramid up to date with the grid and draws the level that fits
+    // pixelsPerTile, positions are in unscaled tile units like the chunk meshes
+    void Draw(sf::RenderTarget& target, const ChunkedGrid& grid,
+        const std::vector<sf::Color>& tileColors, float tileSize, sf::Color color,
+        sf::RenderStates states, float pixelsPerTile);
+    // forces a full rebuild, e.g. after the tile colors changed
+    void Invalidate() { levels.clear(); }
+
+private:
+    struct Level {
+        int width = 0;
+        int height = 0;
+        std::vector<std::uint8_t> pixels;   // rgba, row-major
+        sf::Texture texture;
+        bool hasTexture = false;
+        int dirtyTop = 0;                   // rows changed since the last upload
+        int dirtyBottom = 0;
+    };
+
+    void Reset(const ChunkedGrid& grid);
+    void UpdateChunk(const ChunkedGrid& grid, const std::vector<sf::Color>& tileColors,
+        int chunkX, int chunkY);
+    // recomputes the texels of a level from the level below, inside [x0, x1) x [y0, y1)
+    void Downsample(int levelIndex, int x0, int y0, int x1, int y1);
+    void Upload(Level& level);
+
+    std::vector<Level> levels;
+    std::vector<std::uint64_t> chunkRevisions;  // revision each chunk was sampled at
+    int chunksX = 0;
+    int chunksY = 0;
+    size_t colorCount = 0;      // size of the tile color table it was built with
+};
+
+#endif // !LODPYRAMID_H
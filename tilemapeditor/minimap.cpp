@@ -0,0 +1,160 @@
+#include "minimap.h"
+#include "profiler.h"
+#include <algorithm>
+#include <iostream>
+
+void Minimap::Draw(sf::RenderTarget& target, const std::vector<const ChunkedGrid*>& grids,
+    const std::vector<sf::Color>& tileColors, const sf::FloatRect& viewCells)
+{
+    PROFILE_SCOPE("Minimap::Draw");
+    // panel background, also shown when there is no map yet
+    sf::RectangleShape background(sf::Vector2f(bounds.width, bounds.height));
+    background.setPosition(bounds.left, bounds.top);
+    background.setFillColor(sf::Color(40, 40, 40));
+    target.draw(background);
+
+    // layers added, removed or resized change the layout of the whole summary
+    bool layoutChanged = grids.size() != gridSizes.size() || tileColors.size() != colorCount;
+    for (size_t i = 0; i < grids.size() && !layoutChanged; ++i) {
+        layoutChanged = gridSizes[i] != sf::Vector2i(grids[i]->GetWidth(),
+            grids[i]->GetHeight());
+    }
+    if (layoutChanged) Reset(grids, tileColors.size());
+    if (width <= 0 || height <= 0) return;
+
+    // every layer shares the same chunk layout, so a changed chunk in any layer marks
+    // the same block of the summary
+    for (size_t i = 0; i < grids.size(); ++i) {
+        const ChunkedGrid& grid = *grids[i];
+        for (int chunkY = 0; chunkY < grid.GetChunksY(); ++chunkY) {
+            for (int chunkX = 0; chunkX < grid.GetChunksX(); ++chunkX) {
+                size_t chunkIndex = static_cast<size_t>(chunkY) * grid.GetChunksX() + chunkX;
+                std::uint64_t& revision = chunkRevisions[i][chunkIndex];
+                if (revision == grid.GetChunkRevision(chunkX, chunkY)) continue;
+                revision = grid.GetChunkRevision(chunkX, chunkY);
+                dirtyChunks[static_cast<size_t>(chunkY) * chunksX + chunkX] = 1;
+            }
+        }
+    }
+    for (int chunkY = 0; chunkY < chunksY; ++chunkY) {
+        for (int chunkX = 0; chunkX < chunksX; ++chunkX) {
+            char& dirty = dirtyChunks[static_cast<size_t>(chunkY) * chunksX + chunkX];
+            if (!dirty) continue;
+            dirty = 0;
+            UpdateChunk(grids, tileColors, chunkX, chunkY);
+        }
+    }
+    if (!hasTexture) return;
+
+    sf::FloatRect area = GetMapArea();
+    sf::Sprite sprite(texture);
+    sprite.setPosition(area.left, area.top);
+    sprite.setScale(area.width / width, area.height / height);
+    target.draw(sprite);
+
+    // outline of the part of the map the layer view shows, clipped to the panel
+    float scale = area.width / width;
+    float left = std::max(area.left + viewCells.left * scale, bounds.left);
+    float top = std::max(area.top + viewCells.top * scale, bounds.top);
+    float right = std::min(area.left + (viewCells.left + viewCells.width) * scale,
+        bounds.left + bounds.width);
+    float bottom = std::min(area.top + (viewCells.top + viewCells.height) * scale,
+        bounds.top + bounds.height);
+    if (right <= left || bottom <= top) return;
+    sf::RectangleShape viewRect(sf::Vector2f(right - left, bottom - top));
+    viewRect.setPosition(left, top);
+    viewRect.setFillColor(sf::Color::Transparent);
+    viewRect.setOutlineColor(sf::Color::Red);
+    viewRect.setOutlineThickness(-1.f);
+    target.draw(viewRect);
+}
+
+bool Minimap::PanelToCell(const sf::Vector2f& position, sf::Vector2f& cell) const
+{
+    if (width <= 0 || height <= 0 || !bounds.contains(position)) return false;
+    sf::FloatRect area = GetMapArea();
+    float scale = area.width / width;
+    cell.x = std::clamp((position.x - area.left) / scale, 0.f, static_cast<float>(width));
+    cell.y = std::clamp((position.y - area.top) / scale, 0.f, static_cast<float>(height));
+    return true;
+}
+
+void Minimap::Reset(const std::vector<const ChunkedGrid*>& grids, size_t colorCount)
+{
+    this->colorCount = colorCount;
+    gridSizes.clear();
+    chunkRevisions.clear();
+    width = 0;
+    height = 0;
+    for (const ChunkedGrid* grid : grids) {
+        gridSizes.emplace_back(grid->GetWidth(), grid->GetHeight());
+        // start at zero so every allocated chunk gets composited on the next draw
+        chunkRevisions.emplace_back(static_cast<size_t>(grid->GetChunksX())
+            * grid->GetChunksY(), 0);
+        width = std::max(width, grid->GetWidth());
+        height = std::max(height, grid->GetHeight());
+    }
+    chunksX = (width + ChunkedGrid::ChunkSize - 1) / ChunkedGrid::ChunkSize;
+    chunksY = (height + ChunkedGrid::ChunkSize - 1) / ChunkedGrid::ChunkSize;
+    // empty chunks never change their revision, so the first draw covers everything
+    dirtyChunks.assign(static_cast<size_t>(chunksX) * chunksY, 1);
+    hasTexture = false;
+    if (width <= 0 || height <= 0) return;
+
+    summary.create(width, height, sf::Color::Transparent);
+    if (!texture.create(width, height)) {
+        std::cerr << "Failed to create minimap texture (" << width << "x" << height << ")\n";
+        return;
+    }
+    texture.setSmooth(true);
+    hasTexture = true;
+}
+
+void Minimap::UpdateChunk(const std::vector<const ChunkedGrid*>& grids,
+    const std::vector<sf::Color>& tileColors, int chunkX, int chunkY)
+{
+    int x0 = chunkX * ChunkedGrid::ChunkSize;
+    int y0 = chunkY * ChunkedGrid::ChunkSize;
+    int blockWidth = std::min(ChunkedGrid::ChunkSize, width - x0);
+    int blockHeight = std::min(ChunkedGrid::ChunkSize, height - y0);
+    PROFILE_COUNT(TilesVisited, blockWidth * blockHeight * static_cast<int>(grids.size()));
+    block.resize(static_cast<size_t>(blockWidth) * blockHeight * 4);
+
+    for (int y = 0; y < blockHeight; ++y) {
+        for (int x = 0; x < blockWidth; ++x) {
+            // blend the layers bottom to top with straight alpha
+            unsigned int red = 0, green = 0, blue = 0, alpha = 0;
+            for (const ChunkedGrid* grid : grids) {
+                if (x0 + x >= grid->GetWidth() || y0 + y >= grid->GetHeight()) continue;
+                int index = TileCell::GetIndex(grid->Get(x0 + x, y0 + y));
+                if (index < 0 || index >= static_cast<int>(tileColors.size())) continue;
+                const sf::Color& color = tileColors[index];
+                unsigned int below = alpha * (255 - color.a) / 255;
+                unsigned int outAlpha = color.a + below;
+                if (outAlpha == 0) continue;
+                red = (color.r * color.a + red * below) / outAlpha;
+                green = (color.g * color.a + green * below) / outAlpha;
+                blue = (color.b * color.a + blue * below) / outAlpha;
+                alpha = outAlpha;
+            }
+            sf::Color texel(static_cast<sf::Uint8>(red), static_cast<sf::Uint8>(green),
+                static_cast<sf::Uint8>(blue), static_cast<sf::Uint8>(alpha));
+            summary.setPixel(x0 + x, y0 + y, texel);
+            std::uint8_t* out = block.data() + (static_cast<size_t>(y) * blockWidth + x) * 4;
+            out[0] = texel.r;
+            out[1] = texel.g;
+            out[2] = texel.b;
+            out[3] = texel.a;
+        }
+    }
+    if (hasTexture) texture.update(block.data(), blockWidth, blockHeight, x0, y0);
+}
+
+sf::FloatRect Minimap::GetMapArea() const
+{
+    float scale = std::min(bounds.width / width, bounds.height / height);
+    float areaWidth = width * scale;
+    float areaHeight = height * scale;
+    return sf::FloatRect(bounds.left + (bounds.width - areaWidth) / 2.f,
+        bounds.top + (bounds.height - areaHeight) / 2.f, areaWidth, areaHeight);
+}
@@ -0,0 +1,55 @@
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "chunkedgrid.h"
+
+/*  overview panel of the whole map: a summary image with one texel per cell, colored
+    with the average color of the cell's atlas tile and composited over all layers
+    (layer 0 at the bottom). the summary is kept on the cpu in an sf::Image and on the
+    gpu in an sf::Texture, and only the texels of chunks whose revision stamp changed
+    are recomposited and uploaded, so drawing the panel is a single sprite per frame
+*/
+class Minimap {
+public:
+    // panel area, in the coordinates of the view the minimap is drawn with
+    void SetBounds(const sf::FloatRect& bounds) { this->bounds = bounds; }
+    const sf::FloatRect& GetBounds() const { return bounds; }
+
+    // brings the summary up to date with the layer grids and draws it together with
+    // viewCells, the area of the map (in cells) that the layer view shows
+    void Draw(sf::RenderTarget& target, const std::vector<const ChunkedGrid*>& grids,
+        const std::vector<sf::Color>& tileColors, const sf::FloatRect& viewCells);
+    // converts a panel position to map cell coordinates, clamped to the map,
+    // returns false when the position is outside the panel or there is no map
+    bool PanelToCell(const sf::Vector2f& position, sf::Vector2f& cell) const;
+
+private:
+    void Reset(const std::vector<const ChunkedGrid*>& grids, size_t colorCount);
+    // recomposites the texels of one chunk sized block from every layer and uploads them
+    void UpdateChunk(const std::vector<const ChunkedGrid*>& grids,
+        const std::vector<sf::Color>& tileColors, int chunkX, int chunkY);
+    // area the map is drawn into, the map keeps its aspect ratio inside the panel
+    sf::FloatRect GetMapArea() const;
+
+    sf::FloatRect bounds;
+    sf::Image summary;                  // one texel per cell of the composited map
+    sf::Texture texture;                // gpu copy of summary
+    bool hasTexture = false;
+    std::vector<std::uint8_t> block;    // rgba staging for one chunk's upload
+    int width = 0;                      // map size in cells, the largest layer
+    int height = 0;
+    int chunksX = 0;
+    int chunksY = 0;
+
+    // layout the summary was built for, any change rebuilds it
+    std::vector<sf::Vector2i> gridSizes;
+    size_t colorCount = 0;
+    // revision each layer's chunks were composited at, per layer, row-major
+    std::vector<std::vector<std::uint64_t>> chunkRevisions;
+    std::vector<char> dirtyChunks;      // chunks to recomposite on the next draw
+};
+
+#endif // !MINIMAP_H
@@ -0,0 +1,244 @@
+#include "profiler.h"
+#include "jsonwriter.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+bool Profiler::enabled = false;
+
+namespace {
+    const char* const counterNames[Profiler::CounterCount] = {
+        "draw calls",
+        "vertices",
+        "tiles visited",
+        "input events",
+        "input dispatches"
+    };
+
+    std::string FormatMs(double microseconds)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.2f ms", microseconds / 1000.0);
+        return text;
+    }
+}
+
+Profiler::Profiler()
+    : frames(MaxFrames), origin(std::chrono::steady_clock::now())
+{
+}
+
+Profiler& Profiler::Get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+std::int64_t Profiler::Now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - Get().origin).count();
+}
+
+void Profiler::SetEnabled(bool value)
+{
+    if (value == enabled) return;
+    enabled = value;
+    if (!enabled) return;
+    // start a fresh recording so the ring doesn't mix in frames from an earlier run
+    for (Frame& frame : frames) {
+        frame.events.clear();
+        frame.counters.fill(0);
+        frame.isComplete = false;
+    }
+    frameIndex = 0;
+    frames[frameIndex].start = Now();
+}
+
+void Profiler::ToggleOverlay()
+{
+    showOverlay = !showOverlay;
+    SetEnabled(showOverlay);
+}
+
+void Profiler::BeginFrame()
+{
+    if (!enabled) return;
+    Frame& frame = frames[frameIndex];
+    frame.events.clear();
+    frame.counters.fill(0);
+    frame.isComplete = false;
+    frame.start = Now();
+}
+
+void Profiler::EndFrame()
+{
+    if (!enabled) return;
+    Frame& frame = frames[frameIndex];
+    frame.end = Now();
+    frame.isComplete = true;
+    frameIndex = (frameIndex + 1) % MaxFrames;
+}
+
+void Profiler::AddEvent(const char* name, std::int64_t start, std::int64_t end)
+{
+    frames[frameIndex].events.push_back({ name, start, end });
+}
+
+void Profiler::DrawOverlay(sf::RenderTarget& target, const sf::Font& font)
+{
+    if (!showOverlay) return;
+    PROFILE_SCOPE("Profiler::DrawOverlay");
+
+    const float graphWidth = static_cast<float>(MaxFrames);
+    const float graphHeight = 80.f;
+    const float budget = 1000000.f / 30.f;     // a full height bar is a 30 fps frame
+    sf::Vector2f origin(static_cast<float>(target.getSize().x) - graphWidth - 10.f, 10.f);
+
+    // scope totals averaged over the recorded frames, names are matched by content
+    // because the same literal can have different addresses in different files
+    struct ScopeTotal {
+        const char* name;
+        double total;
+    };
+    std::vector<ScopeTotal> totals;
+    double frameTotal = 0.0;
+    int frameCount = 0;
+    const Frame* lastFrame = nullptr;
+
+    sf::VertexArray bars(sf::Quads);
+    for (int i = 1; i <= MaxFrames; ++i) {
+        // oldest to newest, the frame being recorded is left out
+        const Frame& frame = frames[(frameIndex + i) % MaxFrames];
+        if (!frame.isComplete) continue;
+        double frameTime = static_cast<double>(frame.end - frame.start);
+        frameTotal += frameTime;
+        ++frameCount;
+        lastFrame = &frame;
+        for (const Event& event : frame.events) {
+            auto it = std::find_if(totals.begin(), totals.end(), [&](const ScopeTotal& total) {
+                return std::strcmp(total.name, event.name) == 0;
+            });
+            double duration = static_cast<double>(event.end - event.start);
+            if (it == totals.end()) totals.push_back({ event.name, duration });
+            else it->total += duration;
+        }
+
+        float height = std::min(static_cast<float>(frameTime) / budget, 1.f) * graphHeight;
+        float x = origin.x + static_cast<float>(i - 1);
+        sf::Color color = frameTime > 1000000.0 / 60.0 ? sf::Color(230, 80, 60)
+            : sf::Color(90, 200, 90);
+        bars.append(sf::Vertex(sf::Vector2f(x, origin.y + graphHeight - height), color));
+        bars.append(sf::Vertex(sf::Vector2f(x + 1.f, origin.y + graphHeight - height), color));
+        bars.append(sf::Vertex(sf::Vector2f(x + 1.f, origin.y + graphHeight), color));
+        bars.append(sf::Vertex(sf::Vector2f(x, origin.y + graphHeight), color));
+    }
+
+    // one line per scope and counter below the graph
+    std::string text;
+    if (frameCount > 0) {
+        text += "frame " + FormatMs(frameTotal / frameCount) + " avg\n";
+        std::sort(totals.begin(), totals.end(), [](const ScopeTotal& a, const ScopeTotal& b) {
+            return a.total > b.total;
+        });
+        for (const ScopeTotal& total : totals) {
+            text += std::string(total.name) + "  " + FormatMs(total.total / frameCount) + "\n";
+        }
+        for (int counter = 0; counter < CounterCount; ++counter) {
+            text += std::string(counterNames[counter]) + "  "
+                + std::to_string(lastFrame->counters[counter]) + "\n";
+        }
+    }
+    else {
+        text = "recording...\n";
+    }
+    sf::Text label(text, font, 12);
+    label.setFillColor(sf::Color::White);
+    label.setPosition(origin.x, origin.y + graphHeight + 4.f);
+
+    sf::RectangleShape background(sf::Vector2f(graphWidth,
+        graphHeight + 8.f + label.getLocalBounds().height + label.getLocalBounds().top));
+    background.setPosition(origin);
+    background.setFillColor(sf::Color(0, 0, 0, 180));
+
+    // 60 fps line
+    float budgetY = origin.y + graphHeight - (1000000.f / 60.f) / budget * graphHeight;
+    sf::Vertex budgetLine[2] = {
+        sf::Vertex(sf::Vector2f(origin.x, budgetY), sf::Color(255, 255, 255, 120)),
+        sf::Vertex(sf::Vector2f(origin.x + graphWidth, budgetY), sf::Color(255, 255, 255, 120))
+    };
+
+    target.draw(background);
+    target.draw(bars);
+    target.draw(budgetLine, 2, sf::Lines);
+    target.draw(label);
+}
+
+bool Profiler::ExportChromeTrace(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file for writing: " << filename << "\n";
+        return false;
+    }
+
+    // complete ("X") events for the frames and scopes, counter ("C") events at the
+    // start of each frame, all on one thread of one process
+    JsonWriter writer(file);
+    writer.BeginObject();
+    writer.Key("displayTimeUnit");
+    writer.String("ms");
+    writer.Key("traceEvents");
+    writer.BeginArray();
+    auto writeEvent = [&](const char* name, std::int64_t start, std::int64_t end) {
+        writer.BeginObject();
+        writer.Key("name");
+        writer.String(name);
+        writer.Key("ph");
+        writer.String("X");
+        writer.Key("ts");
+        writer.Int(start);
+        writer.Key("dur");
+        writer.Int(end - start);
+        writer.Key("pid");
+        writer.Int(1);
+        writer.Key("tid");
+        writer.Int(1);
+        writer.EndObject();
+    };
+    for (int i = 1; i <= MaxFrames; ++i) {
+        const Frame& frame = frames[(frameIndex + i) % MaxFrames];
+        if (!frame.isComplete) continue;
+        writeEvent("Frame", frame.start, frame.end);
+        for (const Event& event : frame.events) writeEvent(event.name, event.start, event.end);
+
+        writer.BeginObject();
+        writer.Key("name");
+        writer.String("Counters");
+        writer.Key("ph");
+        writer.String("C");
+        writer.Key("ts");
+        writer.Int(frame.start);
+        writer.Key("pid");
+        writer.Int(1);
+        writer.Key("args");
+        writer.BeginObject();
+        for (int counter = 0; counter < CounterCount; ++counter) {
+            writer.Key(counterNames[counter]);
+            writer.Int(frame.counters[counter]);
+        }
+        writer.EndObject();
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    file.close();
+    if (file.fail()) {
+        std::cerr << "Failed to write trace: " << filename << "\n";
+        return false;
+    }
+    return true;
+}
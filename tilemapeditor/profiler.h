@@ -0,0 +1,109 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <SFML/Graphics.hpp>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*  frame profiler for the main thread: PROFILE_SCOPE("name") times the enclosing block,
+    PROFILE_COUNT(counter, n) adds to a per-frame counter. the last MaxFrames frames are
+    kept in a ring so the overlay can graph them and ExportChromeTrace() can write them
+    as chrome://tracing / perfetto "trace_event" json.
+    while disabled a scope or counter costs a single branch on a bool, defining
+    TILEMAP_NO_PROFILER removes them from the build entirely
+*/
+class Profiler {
+public:
+    enum Counter {
+        DrawCalls,
+        Vertices,
+        TilesVisited,
+        InputEvents,        // events polled by the editor
+        InputDispatches,    // handler calls after coalescing the mouse motion
+        CounterCount
+    };
+
+    // times a scope from construction to destruction, names must be string literals
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(const char* name)
+            : name(Profiler::enabled ? name : nullptr)
+        {
+            if (this->name) start = Profiler::Now();
+        }
+        ~ScopedTimer()
+        {
+            if (name) Profiler::Get().AddEvent(name, start, Profiler::Now());
+        }
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        const char* name;
+        std::int64_t start = 0;
+    };
+
+    static Profiler& Get();
+    static bool IsEnabled() { return enabled; }
+    void SetEnabled(bool value);
+    // F3 toggles profiling together with the overlay
+    void ToggleOverlay();
+    bool IsOverlayVisible() const { return showOverlay; }
+
+    // frame boundaries, called once per iteration of the main loop
+    void BeginFrame();
+    void EndFrame();
+    void AddCount(Counter counter, std::int64_t value)
+    {
+        frames[frameIndex].counters[counter] += value;
+    }
+
+    // draws the frame time graph and the per-scope breakdown in window pixels
+    void DrawOverlay(sf::RenderTarget& target, const sf::Font& font);
+    // writes the recorded frames as chrome trace json, returns false on failure
+    bool ExportChromeTrace(const std::string& filename) const;
+
+    // microseconds since the profiler was created
+    static std::int64_t Now();
+
+private:
+    static constexpr int MaxFrames = 240;
+
+    struct Event {
+        const char* name;
+        std::int64_t start;     // microseconds
+        std::int64_t end;
+    };
+    struct Frame {
+        std::int64_t start = 0;
+        std::int64_t end = 0;
+        bool isComplete = false;
+        std::vector<Event> events;  // capacity is reused when the ring wraps
+        std::array<std::int64_t, CounterCount> counters{};
+    };
+
+    Profiler();
+    void AddEvent(const char* name, std::int64_t start, std::int64_t end);
+
+    static bool enabled;
+    bool showOverlay = false;
+    std::vector<Frame> frames;  // ring of the last MaxFrames frames
+    int frameIndex = 0;         // frame currently being recorded
+    std::chrono::steady_clock::time_point origin;
+};
+
+#ifdef TILEMAP_NO_PROFILER
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNT(counter, value)
+#else
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) Profiler::ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNT(counter, value) \
+    do { if (Profiler::IsEnabled()) Profiler::Get().AddCount(Profiler::counter, (value)); } while (0)
+#endif
+
+#endif // !PROFILER_H
@@ -1,6 +1,8 @@
 #include "tileatlas.h"
 #include "editor.h"
 #include "utility.h"
+#include "profiler.h"
+#include <cmath>
 
 TileAtlas::TileAtlas(Editor& editor) : editor(editor) {}
 
@@ -12,9 +14,40 @@ bool TileAtlas::Initialize()
     }
     atlasSprite.setTexture(textureAtlas);
     atlasSprite.setPosition(0.f, 0.f); // set to top left of the atlas viewport
+    ComputeTileColors(textureAtlas.copyToImage());
+    isDirty = true;
     return true;
 }
 
+void TileAtlas::ComputeTileColors(const sf::Image& image)
+{
+    int tileSize = static_cast<int>(editor.baseTileSize);
+    int columns = GetColumns();
+    int rows = static_cast<int>(image.getSize().y) / tileSize;
+    tileColors.assign(static_cast<size_t>(columns) * rows, sf::Color::Transparent);
+    for (int index = 0; index < static_cast<int>(tileColors.size()); ++index) {
+        sf::IntRect rect = GetTileRect(index);
+        // alpha weighted, so transparent pixels don't pull the color towards black
+        unsigned long sum[3] = { 0, 0, 0 };
+        unsigned long alpha = 0;
+        for (int y = rect.top; y < rect.top + rect.height; ++y) {
+            for (int x = rect.left; x < rect.left + rect.width; ++x) {
+                sf::Color pixel = image.getPixel(x, y);
+                sum[0] += pixel.r * pixel.a;
+                sum[1] += pixel.g * pixel.a;
+                sum[2] += pixel.b * pixel.a;
+                alpha += pixel.a;
+            }
+        }
+        if (alpha == 0) continue;
+        tileColors[index] = sf::Color(
+            static_cast<sf::Uint8>(sum[0] / alpha),
+            static_cast<sf::Uint8>(sum[1] / alpha),
+            static_cast<sf::Uint8>(sum[2] / alpha),
+            static_cast<sf::Uint8>(alpha / (rect.width * rect.height)));
+    }
+}
+
 void TileAtlas::HandleSelection(sf::Vector2f mousePos, bool isSelecting,
     float deltaTime)
 {
@@ -66,12 +99,15 @@ void TileAtlas::HandleSelection(sf::Vector2f mousePos, bool isSelecting,
                     editor.GetTileMap()->currentSelection.tiles.push_back(data);
                 }
             }
+            // rebuild the stamp that painting places
+            editor.GetTileMap()->UpdateStamp();
         }
     }
 }
 
 void TileAtlas::DrawAtlas(sf::RenderTarget& target)
 {
+    PROFILE_SCOPE("TileAtlas::DrawAtlas");
     // offset is based on the view offset which updates when panning
     sf::Vector2f offset = editor.atlasViewOffset;
     // scaledTileSize is based on tileSize which updates when zooming
@@ -82,35 +118,25 @@ void TileAtlas::DrawAtlas(sf::RenderTarget& target)
     // set the atlas sprite position based on the panning offset
     atlasSprite.setPosition(-offset);
     target.draw(atlasSprite);
+    PROFILE_COUNT(DrawCalls, 1);
+    PROFILE_COUNT(Vertices, 4);
 
-    // draw grid with fixed dimensions of 50x100
-    int gridWidth = 50;
-    int gridHeight = 100;
-
-    // starting positions of horizontal and vertical gridlines based on the offset
-    // using round to prevent grid gaps when resizing
-    float startX = std::round(-offset.x);
-    float startY = std::round(-offset.y);
-
-    sf::VertexArray gridLines(sf::Lines);
-
-    for (float x = startX; x <= gridWidth * atlasTileSize - offset.x;
-        x += atlasTileSize) 
-    {
-        gridLines.append(sf::Vertex(sf::Vector2f(x, -offset.y),
-            sf::Color(100, 100, 100, 150)));
-        gridLines.append(sf::Vertex(sf::Vector2f(x, gridHeight * atlasTileSize
-            - offset.y), sf::Color(100, 100, 100, 150)));
-    }
-    for (float y = startY; y <= gridHeight * atlasTileSize - offset.y;
-        y += atlasTileSize) 
-    {
-        gridLines.append(sf::Vertex(sf::Vector2f(-offset.x, y),
-            sf::Color(100, 100, 100, 150)));
-        gridLines.append(sf::Vertex(sf::Vector2f(gridWidth * atlasTileSize
-            - offset.x, y), sf::Color(100, 100, 100, 150)));
-    }
-    target.draw(gridLines);
+    // the grid covers the texture, only the cells inside the atlas view are built.
+    // the offset is rounded to prevent grid gaps when resizing
+    sf::View view = editor.GetAtlasView();
+    sf::Vector2f topLeft = view.getCenter() - view.getSize() / 2.f + offset;
+    sf::Vector2f bottomRight = topLeft + view.getSize();
+    sf::IntRect visibleCells(
+        static_cast<int>(std::floor(topLeft.x / scaledTileSize)),
+        static_cast<int>(std::floor(topLeft.y / scaledTileSize)), 0, 0);
+    visibleCells.width = static_cast<int>(std::ceil(bottomRight.x / scaledTileSize))
+        - visibleCells.left;
+    visibleCells.height = static_cast<int>(std::ceil(bottomRight.y / scaledTileSize))
+        - visibleCells.top;
+    atlasGrid.Update(GetColumns(), GetRows(), scaledTileSize, visibleCells);
+    sf::RenderStates states;
+    states.transform.translate(std::round(-offset.x), std::round(-offset.y));
+    atlasGrid.Draw(target, states);
 }
 
 void TileAtlas::DrawDragSelection(sf::RenderTarget& target)
@@ -171,4 +197,30 @@ void TileAtlas::UpdateTileSize(float scaleFactor)
 {
     // calculate new tile size for zooming using the base tile size and scale factor
     atlasTileSize = static_cast<int>(editor.baseTileSize * scaleFactor);
+    isDirty = true;
+}
+
+int TileAtlas::GetColumns() const
+{
+    // number of tiles in one row of the atlas texture
+    return std::max(1, static_cast<int>(textureAtlas.getSize().x / editor.baseTileSize));
+}
+
+int TileAtlas::GetTileIndex(const sf::IntRect& textureRect) const
+{
+    int tileSize = static_cast<int>(editor.baseTileSize);
+    return (textureRect.top / tileSize) * GetColumns() + (textureRect.left / tileSize);
+}
+
+int TileAtlas::GetRows() const
+{
+    return std::max(1, static_cast<int>(textureAtlas.getSize().y / editor.baseTileSize));
+}
+
+sf::IntRect TileAtlas::GetTileRect(int index) const
+{
+    int tileSize = static_cast<int>(editor.baseTileSize);
+    int columns = GetColumns();
+    return sf::IntRect((index % columns) * tileSize, (index / columns) * tileSize,
+        tileSize, tileSize);
 }
@@ -2,6 +2,7 @@
 #define TILEATLAS_H
 
 #include "tilemap.h"
+#include "gridlines.h"
 
 class Editor;
 
@@ -12,6 +13,9 @@ struct TileAtlas {
     sf::Texture textureAtlas;           // atlas texture
     sf::Sprite atlasSprite;             // atlas sprite
     sf::Vector2f atlasPos = { 0, 0 };   // default atlas position
+    std::vector<sf::Color> tileColors;  // average color per atlas index, for the lod pyramid
+    bool isDirty = true;                // texture or tile size changed since the last frame
+    GridLines atlasGrid;                // one cell per atlas tile, at the zoomed tile size
 
     bool isSelecting = false;
     sf::Vector2i selectionStartIndices; // drag-selection start
@@ -25,7 +29,17 @@ struct TileAtlas {
     void UpdateTileSize(float scaleFactor);
     void DrawAtlas(sf::RenderTarget& target);
     void DrawDragSelection(sf::RenderTarget& target);
+    // conversions between atlas indices and texture rects (in base tile units)
+    int GetColumns() const;
+    int GetRows() const;
+    int GetTileIndex(const sf::IntRect& textureRect) const;
+    sf::IntRect GetTileRect(int index) const;
+    // averages every tile of the atlas image into tileColors
+    void ComputeTileColors(const sf::Image& image);
+    const std::vector<sf::Color>& GetTileColors() const { return tileColors; }
     // getter function to return information about the tile e.g. texture of a tile
     const sf::Texture& GetTexture() { return textureAtlas; }
+    bool NeedsRedraw() const { return isDirty; }
+    void MarkDrawn() { isDirty = false; }
 };
 #endif // !TILEATLAS_H
\ No newline at end of file
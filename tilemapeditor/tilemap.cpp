@@ -1,159 +1,268 @@
 #include "tilemap.h"
 #include "editor.h"
 #include "tileatlas.h"
-#include "utility.h"
-#include "tilemapserializer.h"
+#include <cmath>
+#include "profiler.h"
 
 TileMap::TileMap(Editor& editor, TileAtlas& tileAtlas)
-    : editor(editor), tileAtlas(tileAtlas) {}
+    : editor(editor), tileAtlas(tileAtlas)
+{
+    // the model derives the texture rects of the json format from the atlas layout
+    map.SetAtlasLayout(tileAtlas.GetColumns(), static_cast<int>(editor.baseTileSize));
+}
 
 // -------------------------------- TILE LAYER FUNCTIONS --------------------------------
 
 void TileMap::AddLayer(int width, int height)
 {
-    // create a new TileLayer instance and set passed in properties
-    TileLayer newLayer;
-    newLayer.width = width;
-    newLayer.height = height;
-    newLayer.isVisible = true;
-    newLayer.opacity = 1.0f;
-    newLayer.index = layers.size();
-    newLayer.layer.resize(height, std::vector<Tile>(width));
-    newLayer.collisionGrid.resize(height, std::vector<bool>(width, false));
-    // push the new layer back into the layers vector
-    layers.push_back(newLayer);
     // set this new layer as the current / active layer
-    activeLayerIndex = layers.size() - 1;
+    activeLayerIndex = map.AddLayer(width, height);
+    editLog.Record(EditLog::AddLayer, 0, width, height);
 }
 
-void TileMap::AddTile(const sf::Texture& texture, const sf::IntRect& rect,
-    int index, int x, int y)
+void TileMap::AddTile(int index, int x, int y)
 {
-    if (activeLayerIndex < 0 || activeLayerIndex >= layers.size()) return;
-
-    TileLayer& currentLayer = layers[activeLayerIndex];
-
-    if (x >= 0 && x < currentLayer.width && y >= 0 && y < currentLayer.height) {
-        Tile& tile = currentLayer.layer[y][x];
-        tile.index = index;
-        tile.sprite.setTexture(texture);
-        tile.sprite.setTextureRect(rect);
-        // apply scale factor to the layer tiles
-        tile.sprite.setScale(layerScaleFactor, layerScaleFactor);
-        // apply position based on the tile size
-        tile.sprite.setPosition(x * layerTileSize, y * layerTileSize);
+    if (map.IsInside(activeLayerIndex, x, y)) {
+        // only the packed atlas index is stored, sprites are built when rendering
+        map.SetCell(activeLayerIndex, x, y, TileCell::Make(index));
     }
 }
 
 void TileMap::RemoveTile(const sf::Vector2f mousePos)
 {
-    if (activeLayerIndex < 0 || activeLayerIndex >= layers.size()) {
-        return;
-    }
-
-    TileLayer& currentLayer = layers[activeLayerIndex];
-
-    sf::Vector2i snappedPos = Utility::SnapToGrid(mousePos, editor.layerViewOffset,
-        editor.layerScaleFactor, editor.baseTileSize);
-    int gridX = snappedPos.x / editor.baseTileSize;
-    int gridY = snappedPos.y / editor.baseTileSize;
+    sf::Vector2i cell = MouseToCell(mousePos);
+    EraseCell(cell.x, cell.y);
+}
 
-    if (gridX < 0 || gridX >= currentLayer.width || gridY < 0
-        || gridY >= currentLayer.height) {
-        return;
-    }
+void TileMap::EraseCell(int gridX, int gridY)
+{
+    if (!map.IsInside(activeLayerIndex, gridX, gridY)) return;
 
     if (showCollisionOverlay) {
-        currentLayer.collisionGrid[gridY][gridX] = false;
+        editLog.Record(EditLog::SetCollision, activeLayerIndex, gridX, gridY, 0);
+        map.SetCollision(activeLayerIndex, gridX, gridY, false);
     }
     else {
-        currentLayer.layer[gridY][gridX].index = -1;
-        currentLayer.layer[gridY][gridX].sprite = sf::Sprite();
+        editLog.Record(EditLog::EraseTile, activeLayerIndex, gridX, gridY);
+        // clearing the last tile of a chunk releases the chunk
+        map.SetCell(activeLayerIndex, gridX, gridY, TileCell::Empty);
     }
 }
 
 void TileMap::HandleTilePlacement(const sf::Vector2f& mousePos)
+{
+    // convert mouse position to grid coordinates (accounting for zoom/panning)
+    sf::Vector2i cell = MouseToCell(mousePos);
+    PlaceSelection(cell.x, cell.y);
+}
+
+void TileMap::PlaceSelection(int gridX, int gridY)
 {
     // if there is no texture selection in the currentSelection, exit early
-    if (currentSelection.tiles.empty()) return;
+    if (currentStamp.cells.empty()) return;
+    editLog.Record(EditLog::PlaceStamp, activeLayerIndex, gridX, gridY);
+    PlaceStamp(currentStamp, activeLayerIndex, gridX, gridY);
+}
 
-    // convert mouse position to grid coordinates (accounting for zoom/panning)
-// convert mouse position to grid coordinates (accounting for zoom/panning)
-    sf::Vector2i snappedPos = Utility::SnapToGrid(mousePos, editor.layerViewOffset,
-        editor.layerScaleFactor, editor.baseTileSize);
-    int gridX = snappedPos.x / editor.baseTileSize;
-    int gridY = snappedPos.y / editor.baseTileSize;
+void TileMap::UpdateStamp()
+{
+    currentStamp = Stamp();
+    currentSelection.index = -1;
+    if (currentSelection.tiles.empty()) {
+        editLog.RecordStamp(currentStamp);
+        return;
+    }
 
-    // iterate through each selected tile
+    // the stamp spans the offsets of the selected tiles, the selection start is its origin
+    int minX = 0, minY = 0, maxX = 0, maxY = 0;
     for (const auto& tileData : currentSelection.tiles) {
-        // compute the target grid position using the stored offset
-        int targetX = gridX + tileData.offset.x;
-        int targetY = gridY + tileData.offset.y;
-        // optionally update currentSelection's index based on tiles atlas position
-        currentSelection.index = (tileData.textureRect.top / editor.baseTileSize) *
-            (tileAtlas.GetTexture().getSize().x / editor.baseTileSize) +
-            (tileData.textureRect.left / editor.baseTileSize);
-        // place the tile on the current layer
-        AddTile(tileAtlas.GetTexture(), tileData.textureRect, currentSelection.index,
-            targetX, targetY);
+        minX = std::min(minX, tileData.offset.x);
+        minY = std::min(minY, tileData.offset.y);
+        maxX = std::max(maxX, tileData.offset.x);
+        maxY = std::max(maxY, tileData.offset.y);
     }
+    currentStamp.width = maxX - minX + 1;
+    currentStamp.height = maxY - minY + 1;
+    currentStamp.originX = -minX;
+    currentStamp.originY = -minY;
+    currentStamp.cells.assign(static_cast<size_t>(currentStamp.width) * currentStamp.height,
+        TileCell::Empty);
+    // atlas indices are looked up once here instead of on every placement
+    for (const auto& tileData : currentSelection.tiles) {
+        currentStamp.cells[(tileData.offset.y - minY) * currentStamp.width
+            + (tileData.offset.x - minX)]
+            = TileCell::Make(tileAtlas.GetTileIndex(tileData.textureRect));
+    }
+    currentStamp.hasHoles = std::any_of(currentStamp.cells.begin(), currentStamp.cells.end(),
+        [](Tile tile) { return TileCell::IsEmpty(tile); });
+    currentSelection.index = TileCell::GetIndex(currentStamp.cells[currentStamp.originY
+        * currentStamp.width + currentStamp.originX]);
+    editLog.RecordStamp(currentStamp);
+}
 
+sf::Vector2i TileMap::MouseToCell(const sf::Vector2f& mousePos) const
+{
+    // adjust for panning and zoom, floor so positions left/above the map stay negative
+    sf::Vector2f adjustedPos = (mousePos + editor.layerViewOffset) / editor.layerScaleFactor;
+    return sf::Vector2i(
+        static_cast<int>(std::floor(adjustedPos.x / editor.baseTileSize)),
+        static_cast<int>(std::floor(adjustedPos.y / editor.baseTileSize)));
+}
+
+// -------------------------------- STROKE FUNCTIONS --------------------------------
+
+void TileMap::BeginStroke()
+{
+    EndStroke();
+    map.BeginEdit();
+    editLog.Record(EditLog::BeginStroke);
+    paintStroke.isActive = true;
+    paintStroke.hasLastCell = false;
+}
+
+void TileMap::StrokeTo(const sf::Vector2f& mousePos)
+{
+    // dragging into the layer view with the button already held starts a stroke too
+    if (!paintStroke.isActive) BeginStroke();
+    sf::Vector2i cell = MouseToCell(mousePos);
+    if (!paintStroke.hasLastCell) {
+        QueueStrokeCell(cell);
+    }
+    else if (cell != paintStroke.lastCell) {
+        // bresenham line from the previous pointer cell, so fast drags leave no gaps
+        sf::Vector2i current = paintStroke.lastCell;
+        int deltaX = std::abs(cell.x - current.x);
+        int deltaY = -std::abs(cell.y - current.y);
+        int stepX = current.x < cell.x ? 1 : -1;
+        int stepY = current.y < cell.y ? 1 : -1;
+        int error = deltaX + deltaY;
+        while (current != cell) {
+            int doubledError = 2 * error;
+            if (doubledError >= deltaY) { error += deltaY; current.x += stepX; }
+            if (doubledError <= deltaX) { error += deltaX; current.y += stepY; }
+            QueueStrokeCell(current);
+        }
+    }
+    paintStroke.lastCell = cell;
+    paintStroke.hasLastCell = true;
+}
+
+void TileMap::StrokeAlong(const std::vector<sf::Vector2f>& path)
+{
+    for (const sf::Vector2f& point : path) StrokeTo(point);
+}
+
+void TileMap::QueueStrokeCell(const sf::Vector2i& cell)
+{
+    // a cell is painted once per stroke no matter how often the pointer crosses it
+    std::uint64_t key = (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cell.y)) << 32)
+        | static_cast<std::uint32_t>(cell.x);
+    if (paintStroke.paintedCells.insert(key).second) {
+        paintStroke.pendingCells.push_back(cell);
+    }
+}
+
+void TileMap::FlushStroke()
+{
+    // everything queued since the last frame is written in one go
+    for (const auto& cell : paintStroke.pendingCells) {
+        if (eraserActive) EraseCell(cell.x, cell.y);
+        else if (showCollisionOverlay) PaintCollision(cell.x, cell.y, true);
+        else PlaceSelection(cell.x, cell.y);
+    }
+    paintStroke.pendingCells.clear();
+}
+
+void TileMap::EndStroke()
+{
+    FlushStroke();
+    if (paintStroke.isActive) editLog.Record(EditLog::EndStroke);
+    paintStroke.isActive = false;
+    paintStroke.paintedCells.clear();
+    map.EndEdit();
 }
 
 void TileMap::DrawLayerGrid(sf::RenderTarget& target, int index)
 {
+    PROFILE_SCOPE("TileMap::DrawLayerGrid");
     // don't try to draw a non-existant layer to the window
+    const std::vector<TileLayer>& layers = map.GetLayers();
     if (index < 0 || index >= layers.size()) {
         std::cerr << "Invalid layer index for rendering: " << index << "\n";
         return;
     }
 
-    // get the offset of the layer view that is updated when panning
-    sf::Vector2f offset = editor.layerViewOffset;
     // get the active TileLayer instance from the layers vector
     const TileLayer& layer = layers[index];
 
-    // each tiles position is calculated based on its coordinates in the grid
-    // (x * layerTileSize, y * layerTileSize)
-    for (int y = 0; y < layer.height; ++y) {
-        for (int x = 0; x < layer.width; ++x) {
-            sf::Vector2f tilePosition(static_cast<float>(x * layerTileSize),
-                static_cast<float>(y * layerTileSize));
-            const Tile& tile = layer.layer[y][x];
-            // if tile exists, retrieve it from the Tile struct, set position and draw it
-            if (tile.index >= 0) {
-                sf::Sprite tileSprite = tile.sprite;
-                tileSprite.setColor(sf::Color(255, 255, 255, static_cast<sf::Uint8>(
-                    layer.opacity * 255)));
-                // adjust position relative to panning offset
-                tileSprite.setPosition(tilePosition - offset);
-                target.draw(tileSprite);
-            }
-        }
-    }
+    // tiles are drawn from cached per-chunk meshes in unscaled tile units, the
+    // panning offset and zoom are applied once through the render states
+    sf::Color tileColor(255, 255, 255, static_cast<sf::Uint8>(layer.opacity * 255));
+    // (only chunks inside the visible part of the view are touched)
+    DrawLayerTiles(target, index, tileColor, GetLayerRenderStates(),
+        GetVisibleTileRect(layer));
+    // the grid would be denser than the pixels
+    if (IsLodActive()) return;
+
+    // grid lines are in unscaled world units as well, cached around the visible cells
+    layerGrid.Update(layer.width, layer.height, editor.baseTileSize,
+        GetVisibleTileRect(layer));
+    layerGrid.Draw(target, GetLayerRenderStates());
+}
 
-    float startX = -offset.x;
-    float startY = -offset.y;
+// -------------------------------- UNDO / REDO FUNCTIONS --------------------------------
+
+void TileMap::Undo()
+{
+    // an open stroke is committed first so it becomes the step that gets undone
+    EndStroke();
+    editLog.Record(EditLog::Undo);
+    map.Undo();
+}
 
-    sf::VertexArray gridLines(sf::Lines);
+void TileMap::Redo()
+{
+    EndStroke();
+    editLog.Record(EditLog::Redo);
+    map.Redo();
+}
 
-    for (float x = startX; x <= layer.width * layerTileSize - offset.x; 
-        x += layerTileSize)
-    {
-        gridLines.append(sf::Vertex(sf::Vector2f(x, -offset.y), 
-            sf::Color(100, 100, 100, 150)));
-        gridLines.append(sf::Vertex(sf::Vector2f(x, layer.height * layerTileSize
-            - offset.y), sf::Color(100, 100, 100, 150)));
+// -------------------------------- FILE FUNCTIONS --------------------------------
+
+bool TileMap::LoadTileMap(const std::string& filename)
+{
+    // a stroke left open would record into the history of the new map
+    EndStroke();
+    if (!map.LoadTileMap(filename)) return false;
+    activeLayerIndex = map.GetLayers().empty() ? -1 : 0; // reset active layer
+    return true;
+}
+
+// -------------------------------- BUCKET FILL FUNCTIONS --------------------------------
+
+void TileMap::HandleBucketFill(const sf::Vector2f& mousePos)
+{
+    if (activeLayerIndex < 0 || activeLayerIndex >= map.GetLayers().size()) return;
+
+    // floors like the other tools, so a click left of or above the map isn't cell 0
+    sf::Vector2i cell = MouseToCell(mousePos);
+    int gridX = cell.x;
+    int gridY = cell.y;
+    if (!map.IsInside(activeLayerIndex, gridX, gridY)) return;
+
+    editLog.Record(EditLog::Fill, activeLayerIndex, gridX, gridY,
+        (eraserActive ? EditLog::FillErase : 0)
+        | (showCollisionOverlay ? EditLog::FillCollision : 0));
+    // a fill is always its own undo step
+    map.BeginEdit();
+    if (showCollisionOverlay) {
+        map.FillCollision(activeLayerIndex, gridX, gridY, !eraserActive);
     }
-    for (float y = startY; y <= layer.height * layerTileSize - offset.y;
-        y += layerTileSize)
-    {
-        gridLines.append(sf::Vertex(sf::Vector2f(-offset.x, y), 
-            sf::Color(100, 100, 100, 150)));
-        gridLines.append(sf::Vertex(sf::Vector2f(layer.width * layerTileSize
-            - offset.x, y), sf::Color(100, 100, 100, 150)));
+    else {
+        // the selection stamp is the fill pattern, anchored at the clicked cell
+        map.FillTiles(activeLayerIndex, gridX, gridY, currentStamp, eraserActive);
     }
-    target.draw(gridLines);
+    map.EndEdit();
 }
 
 // -------------------------------- COLLISION LAYER FUNCTIONS --------------------------------
@@ -161,40 +270,30 @@ void TileMap::DrawLayerGrid(sf::RenderTarget& target, int index)
 void TileMap::HandleCollisionPlacement(const sf::Vector2f& mousePos,
     bool addCollision)
 {
-    if (activeLayerIndex < 0 || activeLayerIndex >= layers.size()) return;
-
-    TileLayer& currentLayer = layers[activeLayerIndex];
-    sf::Vector2f adjustedMousePos = (mousePos + editor.layerViewOffset)
-        / layerScaleFactor;
-
-    int gridX = static_cast<int>(adjustedMousePos.x / editor.baseTileSize);
-    int gridY = static_cast<int>(adjustedMousePos.y / editor.baseTileSize);
+    sf::Vector2i cell = MouseToCell(mousePos);
+    PaintCollision(cell.x, cell.y, addCollision);
+}
 
-    if (gridX >= 0 && gridX < currentLayer.width &&
-        gridY >= 0 && gridY < currentLayer.height) {
-        currentLayer.collisionGrid[gridY][gridX] = addCollision;
+void TileMap::PaintCollision(int gridX, int gridY, bool addCollision)
+{
+    if (map.IsInside(activeLayerIndex, gridX, gridY)) {
+        editLog.Record(EditLog::SetCollision, activeLayerIndex, gridX, gridY, addCollision);
+        map.SetCollision(activeLayerIndex, gridX, gridY, addCollision);
     }
 }
 
 void TileMap::DrawCollisionOverlay(sf::RenderTarget& target, int index)
 {
+    PROFILE_SCOPE("TileMap::DrawCollisionOverlay");
+    const std::vector<TileLayer>& layers = map.GetLayers();
     if (index < 0 || index >= layers.size()) return;
 
+    // drawn from greedy-meshed rectangles, a solid area is a few quads per chunk
+    // instead of one shape per cell. world positions, the zoom and pan come from the
+    // layer render states
     const TileLayer& layer = layers[index];
-    sf::RectangleShape collisionTile(sf::Vector2f(layerTileSize, layerTileSize));
-    collisionTile.setFillColor(sf::Color(255, 0, 0, 100)); // semi-transparent red
-
-    for (int y = 0; y < layer.height; ++y) {
-        for (int x = 0; x < layer.width; ++x) {
-            if (layer.collisionGrid[y][x]) {
-                collisionTile.setPosition(
-                    x * layerTileSize - editor.layerViewOffset.x,
-                    y * layerTileSize - editor.layerViewOffset.y
-                );
-                target.draw(collisionTile);
-            }
-        }
-    }
+    GetLayerCollisionMesh(index).Draw(target, layer.collisionGrid, editor.baseTileSize,
+        sf::Color(255, 0, 0, 100), GetLayerRenderStates(), GetVisibleTileRect(layer));
 }
 
 // -------------------------------- SELECTION FUNCTIONS --------------------------------
@@ -231,8 +330,8 @@ void TileMap::HandleSelection(sf::Vector2f mousePos, bool isSelecting,
             currentSelection.tiles.clear();
 
             // access the active layer
-            if (activeLayerIndex >= 0 && activeLayerIndex < layers.size()) {
-                TileLayer& currentLayer = layers[activeLayerIndex];
+            if (activeLayerIndex >= 0 && activeLayerIndex < map.GetLayers().size()) {
+                const TileLayer& currentLayer = map.GetLayers()[activeLayerIndex];
 
                 // compute starting tile indices (in grid units)
                 int startTileX = selectionStartIndices.x / editor.baseTileSize;
@@ -246,12 +345,13 @@ void TileMap::HandleSelection(sf::Vector2f mousePos, bool isSelecting,
                         // ensure the coordinates are within the layer bounds
                         if (tx >= 0 && tx < currentLayer.width && ty >= 0
                             && ty < currentLayer.height) {
-                            const Tile& tile = currentLayer.layer[ty][tx];
+                            Tile tile = currentLayer.Get(tx, ty);
 
                             // only add valid tiles (non-empty)
-                            if (tile.index >= 0) {
+                            if (!TileCell::IsEmpty(tile)) {
                                 SelectedTileData data;
-                                data.textureRect = tile.sprite.getTextureRect();
+                                data.textureRect = tileAtlas.GetTileRect(
+                                    TileCell::GetIndex(tile));
                                 // calculate offset relative to selection start
                                 data.offset = sf::Vector2i(tx - startTileX,
                                     ty - startTileY);
@@ -261,6 +361,7 @@ void TileMap::HandleSelection(sf::Vector2f mousePos, bool isSelecting,
                     }
                 }
             }
+            UpdateStamp();
         }
     }
 }
@@ -283,29 +384,22 @@ void TileMap::DrawDragSelection(sf::RenderTarget& target)
     if (isSelecting) {
         // get the bounds of selection rectangle based on selection indices
         sf::IntRect bounds = GetSelectionBounds();
-        // bounds left/top are scaled with atlasScaleFactor to reflect the zoom level,
-        // the atlasViewOffset is then subtracted to align with a zoomed/panned grid
-        sf::Vector2f adjustedPosition(
-            (bounds.left * editor.layerScaleFactor) - editor.layerViewOffset.x,
-            (bounds.top * editor.layerScaleFactor) - editor.layerViewOffset.y
-        );
-        // bounds width/height are scaled with atlasScaleFactor to reflect zoom level
-        sf::Vector2f adjustedSize(
-            bounds.width * editor.layerScaleFactor,
-            bounds.height * editor.layerScaleFactor
-        );
-        sf::RectangleShape selectionRect(adjustedSize);
-        selectionRect.setPosition(adjustedPosition);
+        // bounds are in unscaled world units, the layer render states apply the
+        // zoom and panning offset
+        sf::RectangleShape selectionRect(sf::Vector2f(bounds.width, bounds.height));
+        selectionRect.setPosition(static_cast<float>(bounds.left),
+            static_cast<float>(bounds.top));
         selectionRect.setFillColor(sf::Color(0, 255, 0, 100));
-        target.draw(selectionRect);
+        target.draw(selectionRect, GetLayerRenderStates());
     }
 }
 
 // -------------------------------- UTILITY FUNCTIONS --------------------------------
 void TileMap::SetCurrentLayer(int index)
 {
-    if (index >= 0 && index < layers.size()) {
+    if (index >= 0 && index < map.GetLayers().size()) {
         activeLayerIndex = index;
+        editLog.Record(EditLog::SelectLayer, activeLayerIndex);
         std::cout << "Switched to layer: " << activeLayerIndex << "\n";
     }
     else {
@@ -333,54 +427,202 @@ void TileMap::HandlePanning(sf::Vector2f mousePos, bool isPanning, float deltaTi
 
 void TileMap::UpdateTileScale(float scaleFactor)
 {
+    // O(1): meshes and overlays are stored in unscaled world units and the zoom is
+    // only part of the render transform, see GetLayerRenderStates
     layerScaleFactor = scaleFactor;
     layerTileSize = editor.baseTileSize * layerScaleFactor;
-
-    for (TileLayer& layer : layers) {
-        for (int y = 0; y < layer.height; ++y) {
-            for (int x = 0; x < layer.width; ++x) {
-                Tile& tile = layer.layer[y][x];
-                if (tile.index >= 0) { // update only valid tiles
-                    tile.sprite.setScale(layerScaleFactor, layerScaleFactor);
-                    tile.sprite.setPosition(x * layerTileSize, y * layerTileSize);
-                }
-            }
-        }
-    }
 }
 
 void TileMap::MergeAllLayers(sf::RenderTarget& target, bool showMergedLayers)
 {
     // if showMergedLayers was passed in as false, exit early
     if (!showMergedLayers) return;
-    sf::Vector2f offset = editor.layerViewOffset;   // get the offset from panning
+    PROFILE_SCOPE("TileMap::MergeAllLayers");
+    // the inactive layers are composited into a cached texture, only re-rendered
+    // when one of them changes, the zoom changes or the view leaves the cached area
+    sf::IntRect viewTiles = GetViewTileRect();
+    if (!IsMergedCacheValid(viewTiles)) {
+        RenderMergedCache(viewTiles);
+    }
+    if (!mergedCache.hasContent) return;
+
+    sf::Sprite composite(mergedCache.texture.getTexture());
+    composite.setPosition(
+        mergedCache.tileRect.left * layerTileSize - editor.layerViewOffset.x,
+        mergedCache.tileRect.top * layerTileSize - editor.layerViewOffset.y);
+    // the cache holds premultiplied colors, drawing it this way blends exactly like
+    // drawing every layer straight onto the target
+    target.draw(composite, sf::RenderStates(sf::BlendMode(sf::BlendMode::One,
+        sf::BlendMode::OneMinusSrcAlpha)));
+    PROFILE_COUNT(DrawCalls, 1);
+    PROFILE_COUNT(Vertices, 4);
+}
+
+bool TileMap::IsMergedCacheValid(const sf::IntRect& viewTiles) const
+{
+    const std::vector<TileLayer>& layers = map.GetLayers();
+    if (!mergedCache.isValid || mergedCache.activeLayerIndex != activeLayerIndex
+        || mergedCache.scaleFactor != layerScaleFactor
+        || mergedCache.layerRevisions.size() != layers.size())
+    {
+        return false;
+    }
+    // the view has to lie completely inside the cached area
+    const sf::IntRect& cached = mergedCache.tileRect;
+    if (viewTiles.left < cached.left || viewTiles.top < cached.top
+        || viewTiles.left + viewTiles.width > cached.left + cached.width
+        || viewTiles.top + viewTiles.height > cached.top + cached.height)
+    {
+        return false;
+    }
+    for (int i = 0; i < layers.size(); ++i) {
+        if (i != activeLayerIndex
+            && mergedCache.layerRevisions[i] != layers[i].layer.GetRevision())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TileMap::RenderMergedCache(const sf::IntRect& viewTiles)
+{
+    PROFILE_SCOPE("TileMap::RenderMergedCache");
+    const std::vector<TileLayer>& layers = map.GetLayers();
+    mergedCache.isValid = true;
+    mergedCache.hasContent = false;
+    mergedCache.activeLayerIndex = activeLayerIndex;
+    mergedCache.scaleFactor = layerScaleFactor;
+    mergedCache.layerRevisions.assign(layers.size(), 0);
+    for (int i = 0; i < layers.size(); ++i) {
+        if (i != activeLayerIndex) mergedCache.layerRevisions[i] = layers[i].layer.GetRevision();
+    }
+
+    // cache half a view of margin on every side so small pans reuse the texture,
+    // keeping the texture within the size the graphics driver supports
+    unsigned int maxSize = sf::Texture::getMaximumSize();
+    int maxTiles = static_cast<int>(maxSize / layerTileSize);
+    int marginX = std::min((viewTiles.width + 1) / 2,
+        std::max((maxTiles - viewTiles.width) / 2, 0));
+    int marginY = std::min((viewTiles.height + 1) / 2,
+        std::max((maxTiles - viewTiles.height) / 2, 0));
+    sf::IntRect tileRect(viewTiles.left - marginX, viewTiles.top - marginY,
+        std::min(viewTiles.width + 2 * marginX, maxTiles),
+        std::min(viewTiles.height + 2 * marginY, maxTiles));
+    mergedCache.tileRect = tileRect;
+    if (tileRect.width <= 0 || tileRect.height <= 0) return;
+
+    sf::Vector2u textureSize(static_cast<unsigned int>(tileRect.width * layerTileSize),
+        static_cast<unsigned int>(tileRect.height * layerTileSize));
+    // only recreate the render texture when the required size changes
+    if (mergedCache.texture.getSize() != textureSize
+        && !mergedCache.texture.create(textureSize.x, textureSize.y))
+    {
+        std::cerr << "Failed to create merged layer texture\n";
+        mergedCache.isValid = false;
+        return;
+    }
+    mergedCache.texture.clear(sf::Color::Transparent);
+    mergedCache.texture.setView(mergedCache.texture.getDefaultView());
+
+    // draw in cache-local pixels, the cached area starts at the texture origin
+    sf::RenderStates states;
+    states.transform.translate(-tileRect.left * layerTileSize, -tileRect.top * layerTileSize);
+    states.transform.scale(layerScaleFactor, layerScaleFactor);
     // loop through layers drawing them at 0.5 opacity
     for (int i = 0; i < layers.size(); ++i) {
-        // when the loop reaches the active layer, skip it as its already drawn
+        // when the loop reaches the active layer, skip it as its drawn on top
         if (i == activeLayerIndex) continue;
         // set layer variable to the current layer index the loop is at
         const TileLayer& layer = layers[i];
         // skip invisible layers
         // if (!layer.isVisible) continue; 
-        // loop through the width/height of current layer drawing tiles at 0.5 opacity
-        for (int y = 0; y < layer.height; ++y) {
-            for (int x = 0; x < layer.width; ++x) {
-                const Tile& tile = layer.layer[y][x];
-                // only draw valid tiles 
-                if (tile.index >= 0) {
-                    // copy the tile at this width/height of the current layer
-                    sf::Sprite tileSprite = tile.sprite;
-                    // set the tile sprite to 0.5 opacity
-                    tileSprite.setColor(sf::Color(255, 255, 255, 100));
-                    tileSprite.setPosition(
-                        (x * layerTileSize) - offset.x,
-                        (y * layerTileSize) - offset.y
-                    );
-                    // make sure it scales to the active layer's size if its' been zoomed
-                    tileSprite.setScale(layerScaleFactor, layerScaleFactor);
-                    target.draw(tileSprite);
-                }
-            }
-        }
+        sf::IntRect layerTiles(0, 0, layer.width, layer.height);
+        sf::IntRect visibleTiles;
+        if (!tileRect.intersects(layerTiles, visibleTiles)) continue;
+        // draw the layer's chunk meshes at 0.5 opacity, scaled to the active zoom
+        DrawLayerTiles(mergedCache.texture, i, sf::Color(255, 255, 255, 100), states,
+            visibleTiles);
+        mergedCache.hasContent = true;
     }
+    mergedCache.texture.display();
+}
+
+ChunkMeshCache& TileMap::GetLayerMesh(int index)
+{
+    // caches are created on demand, a stale cache only costs one rebuild because
+    // chunk revision stamps never repeat between grids
+    if (index >= layerMeshes.size()) layerMeshes.resize(index + 1);
+    return layerMeshes[index];
+}
+
+LodPyramid& TileMap::GetLayerPyramid(int index)
+{
+    if (index >= layerPyramids.size()) layerPyramids.resize(index + 1);
+    return layerPyramids[index];
+}
+
+CollisionOverlayCache& TileMap::GetLayerCollisionMesh(int index)
+{
+    // a cache left over from another map is fixed by its bit comparison
+    if (index >= layerCollisionMeshes.size()) layerCollisionMeshes.resize(index + 1);
+    return layerCollisionMeshes[index];
+}
+
+bool TileMap::IsLodActive() const
+{
+    return editor.baseTileSize * layerScaleFactor < lodPixelsPerTile;
+}
+
+void TileMap::DrawLayerTiles(sf::RenderTarget& target, int index, sf::Color color,
+    const sf::RenderStates& states, const sf::IntRect& visibleTiles)
+{
+    const TileLayer& layer = map.GetLayers()[index];
+    if (IsLodActive()) {
+        // tiles are smaller than a couple of pixels, one quad from the pyramid is enough
+        GetLayerPyramid(index).Draw(target, layer.layer, tileAtlas.GetTileColors(),
+            editor.baseTileSize, color, states, editor.baseTileSize * layerScaleFactor);
+        return;
+    }
+    GetLayerMesh(index).Draw(target, layer.layer, tileAtlas.GetTexture(),
+        tileAtlas.GetColumns(), editor.baseTileSize, color, states, visibleTiles);
+}
+
+sf::RenderStates TileMap::GetLayerRenderStates() const
+{
+    // map unscaled tile units to the panned and zoomed layer view
+    sf::RenderStates states;
+    states.transform.translate(-editor.layerViewOffset);
+    states.transform.scale(layerScaleFactor, layerScaleFactor);
+    return states;
+}
+
+sf::IntRect TileMap::GetVisibleTileRect(const TileLayer& layer) const
+{
+    sf::IntRect viewTiles = GetViewTileRect();
+    // clip to the layer
+    int left = std::max(viewTiles.left, 0);
+    int top = std::max(viewTiles.top, 0);
+    int right = std::min(viewTiles.left + viewTiles.width, layer.width);
+    int bottom = std::min(viewTiles.top + viewTiles.height, layer.height);
+    return sf::IntRect(left, top, std::max(right - left, 0), std::max(bottom - top, 0));
+}
+
+sf::IntRect TileMap::GetViewTileRect() const
+{
+    // visible area of the layer view in view coordinates
+    sf::View view = editor.GetLayerView();
+    sf::Vector2f topLeft = view.getCenter() - view.getSize() / 2.f;
+    sf::Vector2f bottomRight = topLeft + view.getSize();
+    // undo the panning offset and zoom to get cell coordinates, rounding outwards
+    // so partially visible cells are included
+    int left = static_cast<int>(std::floor((topLeft.x + editor.layerViewOffset.x)
+        / layerTileSize));
+    int top = static_cast<int>(std::floor((topLeft.y + editor.layerViewOffset.y)
+        / layerTileSize));
+    int right = static_cast<int>(std::ceil((bottomRight.x + editor.layerViewOffset.x)
+        / layerTileSize));
+    int bottom = static_cast<int>(std::ceil((bottomRight.y + editor.layerViewOffset.y)
+        / layerTileSize));
+    return sf::IntRect(left, top, right - left, bottom - top);
 }
@@ -3,8 +3,14 @@
 
 #include <SFML/Graphics.hpp>
 #include <set>
-#include "json.hpp"
-#include <fstream>
+#include <unordered_set>
+#include <functional>
+#include "mapmodel.h"
+#include "editlog.h"
+#include "chunkmesh.h"
+#include "lodpyramid.h"
+#include "gridlines.h"
+#include "collisionoverlay.h"
 
 class Editor;
 struct TileAtlas;
@@ -15,26 +21,14 @@ private:
 	Editor& editor;
 	TileAtlas& tileAtlas;
 
-	struct Tile {
-		sf::Sprite sprite;						// sprite for the individual tile
-		int index = -1;							// index in the layer
-		std::vector<sf::IntRect> textureRects;	// all tiles' texture regions
-		sf::Texture texture;					// texture of the tile
-		sf::IntRect selectionBounds;			// drag selected area bounds
-	};
-
-	struct TileLayer {
-		int width;				// controls the width and height of the layer
-		int height;
-		bool isVisible;			// used to hide inactive layers
-		float opacity = 0.5f;	// used to change visiblity of active layer when merged
-		int index;				// index to access specific layer in whole game map
-
-		// 2D grid of tiles makes up an entire layer
-		std::vector<std::vector<Tile>> layer;
-		// collision grid for a specific layer
-		std::vector<std::vector<bool>> collisionGrid;
-	};
+	// a tile is a single packed cell (atlas index + flip flags), see tilecell.h
+	using Tile = TileCell::Id;
+	// the layers, edits, history and files live in the window independent MapModel,
+	// TileMap maps mouse input onto it and renders it
+	using TileLayer = MapModel::Layer;
+	MapModel map;
+	// session recording for load tests, every cell level action is logged while it runs
+	EditLog editLog;
 
 	bool isSelecting = false;
 	sf::Vector2i selectionStartIndices; // drag-selection start
@@ -50,37 +44,104 @@ public:
 		int index = -1;						// index in the atlas
 		std::vector<SelectedTileData> tiles;
 		sf::IntRect selectionBounds;		// drag selected area bounds
-		sf::Sprite sprite;					// sprite created from texture and texture rect
 	};
+
+	// precomputed block of packed cells, see MapModel::PlaceStamp
+	using Stamp = MapModel::Stamp;
 private:
-	std::vector<TileLayer> layers;	// vector to hold multiple layers
 	int activeLayerIndex = -1;		// used for setting current active layer
 	float layerTileSize = 16.0f;	// base tile size (e.g. 16x16)
 	float layerScaleFactor = 1.0f;	// default scale factor for zooming
+	std::vector<ChunkMeshCache> layerMeshes;	// render cache per layer, same index as layers
+	std::vector<LodPyramid> layerPyramids;		// zoomed out render cache per layer
+	std::vector<CollisionOverlayCache> layerCollisionMeshes;	// collision rectangles per layer
+	GridLines layerGrid;						// grid of the active layer, in tile units
+
+	// composite of every inactive layer for the merged view
+	struct MergedLayerCache {
+		sf::RenderTexture texture;					// premultiplied composite
+		sf::IntRect tileRect;						// cells covered by the texture
+		std::vector<std::uint64_t> layerRevisions;	// grid revisions it was rendered from
+		int activeLayerIndex = -1;					// layer that was left out
+		float scaleFactor = 0.f;					// zoom it was rendered at
+		bool isValid = false;
+		bool hasContent = false;					// false when there was nothing to draw
+	};
+	MergedLayerCache mergedCache;
+
+	// pointer cells of the current paint stroke, interpolated between mouse events
+	struct PaintStroke {
+		bool isActive = false;
+		bool hasLastCell = false;
+		sf::Vector2i lastCell;								// cell of the previous event
+		std::vector<sf::Vector2i> pendingCells;				// written on the next flush
+		std::unordered_set<std::uint64_t> paintedCells;		// every cell queued this stroke
+	};
+	PaintStroke paintStroke;
+	void QueueStrokeCell(const sf::Vector2i& cell);
+
+	// selection as a ready to place block of cells, rebuilt when the selection changes
+	Stamp currentStamp;
+
+	std::uint64_t drawnRevision = 0;	// content revision of the last rendered frame
 
 public:
 	// shared selection for both atlas and layer
 	SelectedTile currentSelection;
+
+	// places a stamp with its origin on cell (x, y), clipped to the layer and written row
+	// by row as one edit
+	void PlaceStamp(const Stamp& stamp, int layerIndex, int x, int y)
+	{
+		map.PlaceStamp(stamp, layerIndex, x, y);
+	}
+	// rebuilds the stamp painting places, call after changing currentSelection.tiles
+	void UpdateStamp();
+	const Stamp& GetCurrentStamp() const { return currentStamp; }
 	// bool to decide whether to display merged layers or not
 	bool showMergedLayers = false;
 	// bool to active eraser or not
 	bool eraserActive = false;
 	void ToggleEraserMode() { eraserActive = !eraserActive; }
+	// bool to fill whole regions on click instead of painting single cells
+	bool bucketFillActive = false;
+	void ToggleBucketFillMode() { bucketFillActive = !bucketFillActive; }
 	// bool to decide whether to display the collision overlay or not
 	bool showCollisionOverlay = false;
+	// below this many screen pixels per tile layers are drawn from their lod pyramid
+	float lodPixelsPerTile = 2.0f;
 
 	// main TileMap functions
 	TileMap(Editor& editor, TileAtlas& tileAtlas);
 	void DrawLayerGrid(sf::RenderTarget& target, int index);
 	void SetCurrentLayer(int index);
-	void AddTile(const sf::Texture& texture, const sf::IntRect& rect, int index, int x, int y);
+	void AddTile(int index, int x, int y);
 	void RemoveTile(const sf::Vector2f mousePos);
 	void HandleTilePlacement(const sf::Vector2f& mousePos);
+	void HandleBucketFill(const sf::Vector2f& mousePos);
 	void HandlePanning(sf::Vector2f mousePos, bool isPanning, float deltaTime);
 	void UpdateTileScale(float scaleFactor);
 	void HandleSelection(sf::Vector2f mousePos, bool selecting, float deltaTime);
 	sf::IntRect GetSelectionBounds() const;
 	void DrawDragSelection(sf::RenderTarget& target);
+	// a paint stroke is one mouse drag: StrokeTo() queues every cell between the last
+	// and the current pointer position, FlushStroke() writes the queued cells (once per
+	// frame) and everything written between begin and end is a single undo step
+	void BeginStroke();
+	void StrokeTo(const sf::Vector2f& mousePos);
+	// StrokeTo() for every point of a coalesced pointer path
+	void StrokeAlong(const std::vector<sf::Vector2f>& path);
+	void FlushStroke();
+	void EndStroke();
+	// cell versions of the mouse based edits
+	void PlaceSelection(int gridX, int gridY);
+	void EraseCell(int gridX, int gridY);
+	void PaintCollision(int gridX, int gridY, bool addCollision);
+	sf::Vector2i MouseToCell(const sf::Vector2f& mousePos) const;
+	void Undo();
+	void Redo();
+	UndoStack& GetUndoStack() { return map.GetUndoStack(); }
+	EditLog& GetEditLog() { return editLog; }
 	void ToggleVisibility();
 	void ClearLayer();
 	void AddLayer(int width, int height);
@@ -89,11 +150,41 @@ public:
 	void HandleCollisionPlacement(const sf::Vector2f& mousePos, bool addCollision);
 	void AddCollisionTile(int gridX, int gridY);
 	void DrawCollisionOverlay(sf::RenderTarget& target, int index);
-	bool SaveTileMap(const std::string& filename) const;
+	// files go through the model, see MapModel for the formats
+	bool SaveTileMap(const std::string& filename) const { return map.SaveTileMap(filename); }
 	bool LoadTileMap(const std::string& filename);
+	bool ExportCollision(const std::string& filename) const
+	{
+		return map.ExportCollisionJson(filename);
+	}
+	std::function<bool()> MakeSaveJob(const std::string& filename) const
+	{
+		return map.MakeSaveJob(filename);
+	}
+	std::uint64_t GetContentRevision() const { return map.GetContentRevision(); }
+	// true when the map content changed since the last rendered frame
+	bool NeedsRedraw() const { return GetContentRevision() != drawnRevision; }
+	void MarkDrawn() { drawnRevision = GetContentRevision(); }
+	// per-layer chunk mesh caches and the transform they're drawn with
+	ChunkMeshCache& GetLayerMesh(int index);
+	LodPyramid& GetLayerPyramid(int index);
+	CollisionOverlayCache& GetLayerCollisionMesh(int index);
+	// draws a layer's tiles from its meshes, or from its lod pyramid when zoomed out
+	// below lodPixelsPerTile
+	void DrawLayerTiles(sf::RenderTarget& target, int index, sf::Color color,
+		const sf::RenderStates& states, const sf::IntRect& visibleTiles);
+	bool IsLodActive() const;
+	sf::RenderStates GetLayerRenderStates() const;
+	// cells of a layer that intersect the layer view (in cells, clipped to the layer)
+	sf::IntRect GetVisibleTileRect(const TileLayer& layer) const;
+	// cells covered by the layer view, not clipped to any layer
+	sf::IntRect GetViewTileRect() const;
+	bool IsMergedCacheValid(const sf::IntRect& viewTiles) const;
+	void RenderMergedCache(const sf::IntRect& viewTiles);
 	// getter functions
 	const int GetTileSize() const { return layerTileSize; }
 	int GetCurrentLayerIndex() { return activeLayerIndex; }
-	std::vector<TileLayer>& GetLayers() { return layers; }
+	std::vector<TileLayer>& GetLayers() { return map.GetLayers(); }
+	MapModel& GetModel() { return map; }
 };
 #endif // !TILEMAP_H
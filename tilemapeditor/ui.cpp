@@ -2,6 +2,8 @@
 #include "editor.h"
 #include "utility.h"
 #include "tilemap.h"
+#include "tileatlas.h"
+#include "profiler.h"
 
 UI::UI(Editor& editor) : editor(editor) {}
 
@@ -18,14 +20,20 @@ bool UI::Initialize()
 void UI::HandleInteraction(const sf::Vector2f& mousePos,
     sf::RenderWindow& window)
 {
+    if (minimap.GetBounds().contains(mousePos)) {
+        isMinimapDragging = true;
+        JumpToMinimap(mousePos);
+        return;
+    }
     for (const auto& button : buttons) {
         // check each buttons bounds to see if it contains the mouse position
         if (button.shape.getGlobalBounds().contains(mousePos)) {
             // get the label text from each button
             std::string label = button.label.getString();
-            if (label == "Save Tilemap" || label == "Load Tilemap") {
+            if (label == "Save Tilemap" || label == "Load Tilemap"
+                || label == "Export Collision") {
                 lastClickedButton = label;
-                // activate text input for saving or loading a tile map file
+                // activate text input for the file to save, load or export to
                 ActivateTextInput();
             }
             // depending on which button was pressed, pass different layer sizes
@@ -49,6 +57,9 @@ void UI::HandleInteraction(const sf::Vector2f& mousePos,
             else if (label == "Eraser") {
                 editor.GetTileMap()->ToggleEraserMode();
             }
+            else if (label == "Bucket Fill") {
+                editor.GetTileMap()->ToggleBucketFillMode();
+            }
             else if (label == "Toggle Collision") {
                 editor.GetTileMap()->showCollisionOverlay
                     = !editor.GetTileMap()->showCollisionOverlay;
@@ -63,6 +74,7 @@ void UI::HandleInteraction(const sf::Vector2f& mousePos,
 
 void UI::DrawUI(sf::RenderWindow& window)
 {
+    PROFILE_SCOPE("UI::DrawUI");
     // populate the buttons vector if empty 
     if (buttons.empty()) {
         sf::Vector2f buttonSize(200.f, 25.f);   // button dimensions
@@ -80,12 +92,14 @@ void UI::DrawUI(sf::RenderWindow& window)
             "100x100 Grid",
             "200x200 Grid",
             "Eraser",
+            "Bucket Fill",
             "Toggle Collision"
         };
         std::vector<std::string> rightButtons = {
             "Save Tilemap",
             "Load Tilemap",
-            "Merge Layers"
+            "Merge Layers",
+            "Export Collision"
         };
 
         // iterate through the button labels vector and create buttons
@@ -129,12 +143,77 @@ void UI::DrawUI(sf::RenderWindow& window)
             buttons.push_back(button);
             rightY += buttonSize.y + buttonSpacing;
         }
+
+        // square minimap panel against the right edge of the ui view
+        sf::Vector2f uiSize = editor.GetUIView().getSize();
+        float minimapSize = uiSize.y - 2.f * buttonSpacing;
+        minimap.SetBounds(sf::FloatRect(uiSize.x - minimapSize - buttonSpacing,
+            buttonSpacing, minimapSize, minimapSize));
     }
     for (const auto& button : buttons) {
         // draw the button and its label
         window.draw(button.shape);
         window.draw(button.label);
     }
+    isStatusShown = IsStatusVisible();
+    if (isStatusShown) {
+        window.draw(statusText);
+    }
+
+    // the layer view in cells: view = cell * tileSize * scale - offset
+    std::shared_ptr<TileMap> tileMap = editor.GetTileMap();
+    std::vector<const ChunkedGrid*> grids;
+    for (const auto& layer : tileMap->GetLayers()) grids.push_back(&layer.layer);
+    sf::View layerView = editor.GetLayerView();
+    float cellSize = editor.baseTileSize * editor.layerScaleFactor;
+    sf::Vector2f topLeft = layerView.getCenter() - layerView.getSize() / 2.f
+        + editor.layerViewOffset;
+    sf::FloatRect viewCells(topLeft / cellSize, layerView.getSize() / cellSize);
+    minimap.Draw(window, grids, editor.GetTileAtlas()->GetTileColors(), viewCells);
+}
+
+void UI::JumpToMinimap(const sf::Vector2f& mousePos)
+{
+    sf::Vector2f cell;
+    if (!minimap.PanelToCell(mousePos, cell)) return;
+    sf::View layerView = editor.GetLayerView();
+    float cellSize = editor.baseTileSize * editor.layerScaleFactor;
+    // offset that puts the cell at the center of the layer view
+    editor.layerViewOffset = cell * cellSize - layerView.getCenter();
+}
+
+void UI::HandleMinimapDrag(const sf::Vector2f& mousePos)
+{
+    if (isMinimapDragging) JumpToMinimap(mousePos);
+}
+
+void UI::SetStatus(const std::string& text)
+{
+    statusText.setFont(font);
+    statusText.setString(text);
+    statusText.setCharacterSize(16);
+    statusText.setFillColor(sf::Color::White);
+    statusText.setPosition(415.f, 60.f);    // below the filename input box
+    statusClock.restart();
+    hasStatus = true;
+    isDirty = true; // saves report from the worker, without an input event
+    std::cout << text << "\n";
+}
+
+bool UI::IsStatusVisible() const
+{
+    return hasStatus && statusClock.getElapsedTime().asSeconds() < statusDuration;
+}
+
+sf::Time UI::GetStatusTimeLeft() const
+{
+    if (!isStatusShown || !IsStatusVisible()) return sf::Time::Zero;
+    return sf::seconds(statusDuration) - statusClock.getElapsedTime();
+}
+
+bool UI::NeedsRedraw() const
+{
+    return isDirty || (isStatusShown && !IsStatusVisible());
 }
 
 void UI::ResetButtons() {
@@ -176,10 +255,19 @@ void UI::HandleTextInput(const sf::Event& event)
                 std::cout << "Filename entered: " << inputText << "\n";
                 // call save or load function
                 if (lastClickedButton == "Save Tilemap") {
-                    editor.GetTileMap()->SaveTileMap(inputText);
+                    // written in the background, the result shows up in the status text
+                    editor.RequestSave(inputText);
                 }
                 else if (lastClickedButton == "Load Tilemap") {
-                    editor.GetTileMap()->LoadTileMap(inputText);
+                    // a recording can't follow the switch to another map
+                    editor.StopEditRecording();
+                    bool loaded = editor.GetTileMap()->LoadTileMap(inputText);
+                    SetStatus((loaded ? "Loaded " : "Failed to load ") + inputText);
+                }
+                else if (lastClickedButton == "Export Collision") {
+                    bool exported = editor.GetTileMap()->ExportCollision(inputText);
+                    SetStatus((exported ? "Exported collision to " : "Failed to export ")
+                        + inputText);
                 }
             }
             else if (event.key.code == sf::Keyboard::Escape) {
@@ -3,6 +3,7 @@
 
 #include <SFML/Graphics.hpp>
 #include <vector>
+#include "minimap.h"
 
 class Editor;
 
@@ -22,6 +23,14 @@ private:
     sf::RectangleShape inputBox;    // rectangle element for the input box
     sf::Text inputTextDisplay;  // text to display the input to the screen
     std::string lastClickedButton;  // string to store which button was pressed (between save or load tilemap buttons)
+    sf::Text statusText;    // last save/load message, hidden after a few seconds
+    sf::Clock statusClock;
+    bool hasStatus = false;
+    const float statusDuration = 5.f;   // seconds the status stays visible
+    bool isStatusShown = false; // the last drawn frame contains the status
+    bool isDirty = true;    // changed outside of input handling since the last frame
+    Minimap minimap;    // overview of the whole map at the right edge of the ui
+    bool isMinimapDragging = false; // left button went down inside the minimap
 public:
     UI(Editor& editor);
     bool Initialize();
@@ -31,5 +40,18 @@ public:
     void HandleTextInput(const sf::Event& event);
     void DrawTextInput(sf::RenderWindow& window);
     void DrawUI(sf::RenderWindow& window);
+    void SetStatus(const std::string& text);
+    bool IsTextInputActive() const { return isTextInputActive; }
+    bool IsStatusVisible() const;
+    // time until a shown status disappears, zero when none is shown
+    sf::Time GetStatusTimeLeft() const;
+    // true after a status change or when a shown status has timed out
+    bool NeedsRedraw() const;
+    void MarkDrawn() { isDirty = false; }
+    const sf::Font& GetFont() const { return font; }
+    // centers the layer view on the map cell under a minimap position
+    void JumpToMinimap(const sf::Vector2f& mousePos);
+    void HandleMinimapDrag(const sf::Vector2f& mousePos);
+    void EndMinimapDrag() { isMinimapDragging = false; }
 };
 #endif